@@ -1,8 +1,16 @@
+#define _POSIX_C_SOURCE 199309L // clock_gettime
+
 #include <raylib.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #define REG_COUNT 16
 #define MEMORY_SIZE 0x10000 // 64 KB
@@ -12,9 +20,58 @@
 #define STACK_BEGIN         0xFFFE
 #define STACK_END           0xF900
 
+#define MMIO_ADDRESS            0xF800 // Mapped I/O window, up to STACK_END
 #define RX_ADDRESS              0xF800 // Writing to this address prints to console
 #define TX_ADDRESS              0xF801 // Reading from here reads from console
 
+// Performance counters, 32-bit values split into two words.
+// Reading low word latches high word, so reading low then high is consistent.
+#define INSTRUCTIONS_ADDRESS    0xF810 // instructions executed
+#define TIMER_ADDRESS           0xF814 // microseconds since start
+#define MEMORY_OPS_ADDRESS      0xF818 // loads, stores, pushes and pops
+#define BRANCHES_ADDRESS        0xF81C // jumps taken
+#define CALLS_ADDRESS           0xF820 // calls
+#define COUNTER_COUNT 5
+
+// Block storage device, 512-byte sectors of a host file.
+// Writing command register transfers COUNT sectors between disk and BUFFER at once.
+#define DISK_SECTOR_ADDRESS     0xF830 // first sector
+#define DISK_BUFFER_ADDRESS     0xF832 // heap address to transfer to/from
+#define DISK_COUNT_ADDRESS      0xF834 // number of sectors
+#define DISK_COMMAND_ADDRESS    0xF836 // write-only, starts transfer
+#define DISK_STATUS_ADDRESS     0xF838 // result of last command
+#define DISK_SIZE_ADDRESS       0xF83A // read-only, disk size in sectors
+#define DISK_SECTOR_SIZE    512
+#define DISK_COMMAND_READ   1 // disk -> memory
+#define DISK_COMMAND_WRITE  2 // memory -> disk
+#define DISK_STATUS_IDLE    0
+#define DISK_STATUS_DONE    1
+#define DISK_STATUS_ERROR   2
+
+// System calls, service number is SYS immediate, arguments and results in registers
+#define SYS_PUTS    0 // print string at R0
+#define SYS_PUTU    1 // print R0 as unsigned decimal
+#define SYS_PUTI    2 // print R0 as signed decimal
+#define SYS_PUTX    3 // print R0 as hex
+#define SYS_PARSEU  4 // parse unsigned decimal at R0: R0 - value, R1 - chars consumed, C - error
+#define SYS_PARSEI  5 // parse signed decimal, same as SYS_PARSEU
+#define SYS_PARSEX  6 // parse hex, same as SYS_PARSEU
+#define SYS_GETS    7 // read line to buffer R0 of R1 bytes: R1 - length
+#define SYS_MEMSET  8 // fill R2 bytes at R0 with R1
+#define SYS_COUNT   9
+
+// Heap allocator arena, upper part of heap. Lower part is left for static data.
+// Arena is split into pages, each page holds blocks of one size class or is part of a large block.
+#define ALLOC_ARENA_ADDRESS 0x8000
+#define ALLOC_ARENA_END     MMIO_ADDRESS
+#define ALLOC_PAGE_COUNT    ((ALLOC_ARENA_END - ALLOC_ARENA_ADDRESS) / PAGE_SIZE)
+#define ALLOC_MIN_SIZE      8 // smallest size class, classes double up to PAGE_SIZE / 2
+#define ALLOC_CLASS_COUNT   5
+#define ALLOC_BLOCK_COUNT   ((ALLOC_ARENA_END - ALLOC_ARENA_ADDRESS) / ALLOC_MIN_SIZE) // most blocks in arena
+#define ALLOC_PAGE_FREE     0
+#define ALLOC_PAGE_LARGE    (ALLOC_CLASS_COUNT + 1) // first page of large block
+#define ALLOC_PAGE_CONT     (ALLOC_CLASS_COUNT + 2) // other pages of large block
+
 // FLAGS register is split into bits using these bitmasks:
 #define ZERO_FLAG   0x80  // 1000 0000
 #define CARRY_FLAG  0x40  // 0100 0000
@@ -29,6 +86,34 @@
 #define HIGH_BYTE_MASK 0xFF00
 #define MSB_MASK 0x8000
 
+// Memory is split into 256-byte pages for watchpoints and checkpoints
+#define PAGE_SIZE 256
+#define PAGE_COUNT (MEMORY_SIZE / PAGE_SIZE)
+
+// Debugger limits
+#define MAX_BREAKPOINTS 32
+#define MAX_WATCHPOINTS 32
+#define MAX_SYMBOLS 512
+#define SYMBOL_NAME_LENGTH 32
+#define CONSOLE_LINE_LENGTH 128
+#define CHECKPOINT_COUNT 64 // checkpoint ring size
+
+// Timing model defaults
+#define DEFAULT_CACHE_SETS 64
+#define DEFAULT_CACHE_WAYS 2
+#define DEFAULT_CACHE_LINE 16
+#define DEFAULT_HIT_LATENCY 1
+#define DEFAULT_MISS_LATENCY 20
+#define DEFAULT_BRANCH_PENALTY 2
+#define TIMING_REPORT_COUNT 10 // PCs shown in report
+
+// Force inlining so each engine instance is specialized at compile time
+#if defined(__GNUC__)
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define ALWAYS_INLINE inline
+#endif
+
 // Opcodes
 // Control flow
 #define OPCODE_NOP      0x00
@@ -42,6 +127,7 @@
 #define OPCODE_JS       0x08
 #define OPCODE_CALL     0x09
 #define OPCODE_RET      0x0A
+#define OPCODE_SYS      0x0B
 
 // Memory
 #define OPCODE_MOVR     0x10
@@ -70,6 +156,12 @@
 #define OPCODE_MULI     0x27
 #define OPCODE_DIVR     0x28
 #define OPCODE_DIVI     0x29
+#define OPCODE_ADCR     0x2A
+#define OPCODE_ADCI     0x2B
+#define OPCODE_SBCR     0x2C
+#define OPCODE_SBCI     0x2D
+#define OPCODE_MULWR    0x2E
+#define OPCODE_DIVMODR  0x2F
 
 // Bit ops
 #define OPCODE_ANDR     0x30
@@ -91,6 +183,42 @@
 #define OPCODE_GETBP    0x45
 #define OPCODE_ADDBP    0x46
 #define OPCODE_SUBBP    0x47
+#define OPCODE_ENTER    0x48
+#define OPCODE_LEAVE    0x49
+#define OPCODE_LOADRF   0x4A
+#define OPCODE_STORFR   0x4B
+#define OPCODE_LOADBRF  0x4C
+#define OPCODE_STORBFR  0x4D
+
+// Memory, extended addressing
+#define OPCODE_LOADRX   0x50 // [reg + disp]
+#define OPCODE_STORXR   0x51
+#define OPCODE_LOADBRX  0x52
+#define OPCODE_STORBXR  0x53
+#define OPCODE_LOADRPI  0x54 // [reg+], post-increment
+#define OPCODE_STORPIR  0x55
+#define OPCODE_LOADBRPI 0x56
+#define OPCODE_STORBPIR 0x57
+#define OPCODE_LOADRPD  0x58 // [-reg], pre-decrement
+#define OPCODE_STORPDR  0x59
+#define OPCODE_LOADBRPD 0x5A
+#define OPCODE_STORBPDR 0x5B
+
+// Control flow, short: signed 8-bit displacement from next instruction
+#define OPCODE_JMPS     0x60
+#define OPCODE_JZS      0x61
+#define OPCODE_JNZS     0x62
+#define OPCODE_JCS      0x63
+#define OPCODE_JSS      0x64
+#define OPCODE_CALLS    0x65
+
+// Heap allocator
+#define OPCODE_ALLOCR   0x70
+#define OPCODE_ALLOCI   0x71
+#define OPCODE_FREE     0x72
+
+// Reserved trap opcode, patched over instructions by the debugger
+#define OPCODE_BRK      0xFF
 
 // Encoding formats enum
 typedef enum {
@@ -99,6 +227,9 @@ typedef enum {
     FORMAT_REG_REG, 
     FORMAT_IMM, // can be either immediate or address
     FORMAT_REG_IMM, 
+    FORMAT_REG_DISP8, // register and signed 8-bit displacement
+    FORMAT_REG_REG_IMM, // two registers and 16-bit displacement
+    FORMAT_DISP8, // signed 8-bit displacement from next instruction, decoded to address
 } EncodingFormat;
 
 // Opcode struct for storing name and format
@@ -121,6 +252,7 @@ OpcodeData opcode_table[256] = {
     [OPCODE_JS]      = {"JS",      FORMAT_IMM},
     [OPCODE_CALL]    = {"CALL",    FORMAT_IMM},
     [OPCODE_RET]     = {"RET",     FORMAT_NONE},
+    [OPCODE_SYS]     = {"SYS",     FORMAT_IMM},
     // Memory
     [OPCODE_MOVR]    = {"MOVR",    FORMAT_REG_REG},
     [OPCODE_MOVI]    = {"MOVI",    FORMAT_REG_IMM},
@@ -147,6 +279,12 @@ OpcodeData opcode_table[256] = {
     [OPCODE_MULI]    = {"MULI",    FORMAT_REG_IMM},
     [OPCODE_DIVR]    = {"DIVR",    FORMAT_REG_REG},
     [OPCODE_DIVI]    = {"DIVI",    FORMAT_REG_IMM},
+    [OPCODE_ADCR]    = {"ADCR",    FORMAT_REG_REG},
+    [OPCODE_ADCI]    = {"ADCI",    FORMAT_REG_IMM},
+    [OPCODE_SBCR]    = {"SBCR",    FORMAT_REG_REG},
+    [OPCODE_SBCI]    = {"SBCI",    FORMAT_REG_IMM},
+    [OPCODE_MULWR]   = {"MULWR",   FORMAT_REG_REG},
+    [OPCODE_DIVMODR] = {"DIVMODR", FORMAT_REG_REG},
 
     // Bit ops
     [OPCODE_ANDR]    = {"ANDR",    FORMAT_REG_REG},
@@ -168,6 +306,42 @@ OpcodeData opcode_table[256] = {
     [OPCODE_GETBP]   = {"GETBP",   FORMAT_REG},
     [OPCODE_ADDBP]   = {"ADDBP",   FORMAT_IMM},
     [OPCODE_SUBBP]   = {"SUBBP",   FORMAT_IMM},
+    [OPCODE_ENTER]   = {"ENTER",   FORMAT_IMM},
+    [OPCODE_LEAVE]   = {"LEAVE",   FORMAT_NONE},
+    [OPCODE_LOADRF]  = {"LOADRF",  FORMAT_REG_DISP8},
+    [OPCODE_STORFR]  = {"STORFR",  FORMAT_REG_DISP8},
+    [OPCODE_LOADBRF] = {"LOADBRF", FORMAT_REG_DISP8},
+    [OPCODE_STORBFR] = {"STORBFR", FORMAT_REG_DISP8},
+
+    // Memory, extended addressing
+    [OPCODE_LOADRX]   = {"LOADRX",   FORMAT_REG_REG_IMM},
+    [OPCODE_STORXR]   = {"STORXR",   FORMAT_REG_REG_IMM},
+    [OPCODE_LOADBRX]  = {"LOADBRX",  FORMAT_REG_REG_IMM},
+    [OPCODE_STORBXR]  = {"STORBXR",  FORMAT_REG_REG_IMM},
+    [OPCODE_LOADRPI]  = {"LOADRPI",  FORMAT_REG_REG},
+    [OPCODE_STORPIR]  = {"STORPIR",  FORMAT_REG_REG},
+    [OPCODE_LOADBRPI] = {"LOADBRPI", FORMAT_REG_REG},
+    [OPCODE_STORBPIR] = {"STORBPIR", FORMAT_REG_REG},
+    [OPCODE_LOADRPD]  = {"LOADRPD",  FORMAT_REG_REG},
+    [OPCODE_STORPDR]  = {"STORPDR",  FORMAT_REG_REG},
+    [OPCODE_LOADBRPD] = {"LOADBRPD", FORMAT_REG_REG},
+    [OPCODE_STORBPDR] = {"STORBPDR", FORMAT_REG_REG},
+
+    // Control flow, short
+    [OPCODE_JMPS]     = {"JMPS",     FORMAT_DISP8},
+    [OPCODE_JZS]      = {"JZS",      FORMAT_DISP8},
+    [OPCODE_JNZS]     = {"JNZS",     FORMAT_DISP8},
+    [OPCODE_JCS]      = {"JCS",      FORMAT_DISP8},
+    [OPCODE_JSS]      = {"JSS",      FORMAT_DISP8},
+    [OPCODE_CALLS]    = {"CALLS",    FORMAT_DISP8},
+
+    // Heap allocator
+    [OPCODE_ALLOCR]   = {"ALLOCR",   FORMAT_REG_REG},
+    [OPCODE_ALLOCI]   = {"ALLOCI",   FORMAT_REG_IMM},
+    [OPCODE_FREE]     = {"FREE",     FORMAT_REG},
+
+    // Debugger
+    [OPCODE_BRK]     = {"BRK",     FORMAT_NONE},
 };
 
 // CPU struct stores CPU internal data: registers, PC, SP, BP and flags
@@ -177,12 +351,132 @@ typedef struct {
     uint8_t flags;
 } CPU;
 
+// Breakpoint stores patched address and the original opcode byte
+typedef struct {
+    uint16_t address;
+    uint8_t original;
+} Breakpoint;
+
+// Symbol loaded from assembler symbol table
+typedef struct {
+    char name[SYMBOL_NAME_LENGTH];
+    uint16_t address;
+} Symbol;
+
+// Result of executing instructions
+typedef enum {
+    VM_RUNNING,
+    VM_HALTED,
+    VM_BREAKPOINT,
+    VM_WATCHPOINT,
+    VM_FAULT,
+} VMStatus;
+
+// Cache line of simulated data cache
+typedef struct {
+    uint16_t tag;
+    uint8_t valid;
+    uint64_t last_use; // for LRU replacement
+} CacheLine;
+
+// Timing model: per-opcode latencies, branch penalty and data cache simulator
+typedef struct {
+    uint8_t enabled;
+    uint64_t cycles;
+
+    uint8_t latency[256]; // cycles per opcode
+    uint8_t branch_penalty; // extra cycles for taken branch
+    uint8_t hit_latency, miss_latency; // extra cycles for memory access
+
+    uint16_t sets, ways, line_size;
+    CacheLine *lines; // sets * ways
+    uint64_t hits, misses;
+    uint32_t *pc_hits, *pc_misses; // per instruction address in program space
+} Timing;
+
+// Per-category performance counters
+typedef struct {
+    uint64_t memory_ops;
+    uint64_t branches;
+    uint64_t calls;
+} Counters;
+
+// Heap allocator metadata, kept outside guest memory
+typedef struct {
+    uint8_t page_kind[ALLOC_PAGE_COUNT]; // ALLOC_PAGE_*, or size class + 1 for small blocks
+    uint8_t page_run[ALLOC_PAGE_COUNT]; // pages in large block, on its first page
+    uint32_t slots_used[ALLOC_PAGE_COUNT]; // bitmap of used blocks in small block page
+    uint8_t slack[ALLOC_BLOCK_COUNT]; // block size minus requested size, by block offset / ALLOC_MIN_SIZE
+
+    uint32_t live_bytes, peak_bytes; // requested sizes of live blocks
+    uint32_t live_slack; // rounding of live blocks to block size
+    uint32_t live_blocks;
+    uint64_t allocations, frees, failures;
+} Allocator;
+
+// Block storage device backed by memory-mapped host file
+typedef struct {
+    uint8_t *data; // NULL if no disk attached
+    size_t size;
+    uint32_t sectors;
+} Disk;
+
+// Checkpoint stores CPU and pages dirtied since previous checkpoint
+typedef struct {
+    CPU cpu;
+    uint64_t instructions;
+    Counters counters;
+    Allocator allocator;
+    size_t input_position;
+
+    uint16_t page_count;
+    uint8_t page_numbers[PAGE_COUNT];
+    uint8_t *pages; // page_count * PAGE_SIZE bytes
+} Checkpoint;
+
 // VM struct stores CPU and RAM
 typedef struct {
     CPU cpu;
     uint8_t memory[MEMORY_SIZE]; // 64 KB RAM
 
     uint8_t debug; // 0 - quiet, 1 - verbose
+
+    // Debugger state
+    Breakpoint breakpoints[MAX_BREAKPOINTS];
+    uint8_t breakpoint_count;
+    uint16_t watchpoints[MAX_WATCHPOINTS];
+    uint8_t watchpoint_count;
+    uint8_t watch_pages[PAGE_COUNT]; // number of watchpoints on each page
+    uint16_t watch_hit; // address of last triggered watchpoint
+
+    Symbol symbols[MAX_SYMBOLS]; // sorted by address
+    size_t symbol_count;
+
+    // Performance counters
+    uint64_t instructions; // instructions executed
+    Counters counters;
+    uint64_t start_time; // host time in microseconds
+    uint16_t counter_latches[COUNTER_COUNT]; // high words latched on low word read
+
+    Timing timing;
+
+    Allocator allocator;
+
+    // Block device, its registers live in mapped I/O memory
+    Disk disk;
+
+    // Checkpoints for reverse execution
+    uint8_t dirty_pages[PAGE_COUNT]; // pages written since last checkpoint
+    uint64_t checkpoint_interval; // 0 - disabled
+    uint64_t next_checkpoint;
+    Checkpoint checkpoints[CHECKPOINT_COUNT]; // ring
+    size_t checkpoint_first, checkpoint_count;
+    uint8_t *checkpoint_base; // memory at oldest checkpoint
+
+    // Input log for deterministic re-execution
+    uint16_t *input_log;
+    size_t input_length, input_capacity, input_position;
+    uint64_t replay_end; // output of instructions up to this count was already printed
 } VM;
 
 // initialize CPU, set all registers to zero
@@ -200,6 +494,48 @@ void init_vm(VM *vm) {
     memset(vm->memory, 0, sizeof(vm->memory));
 
     vm->debug = 0;
+
+    vm->breakpoint_count = 0;
+    vm->watchpoint_count = 0;
+    memset(vm->watch_pages, 0, sizeof(vm->watch_pages));
+    vm->watch_hit = 0;
+    vm->symbol_count = 0;
+
+    vm->instructions = 0;
+    memset(&vm->counters, 0, sizeof(vm->counters));
+    vm->start_time = 0;
+    memset(vm->counter_latches, 0, sizeof(vm->counter_latches));
+    memset(&vm->timing, 0, sizeof(vm->timing));
+    memset(&vm->allocator, 0, sizeof(vm->allocator));
+    memset(&vm->disk, 0, sizeof(vm->disk));
+
+    memset(vm->dirty_pages, 0, sizeof(vm->dirty_pages));
+    vm->checkpoint_interval = 0;
+    vm->next_checkpoint = UINT64_MAX;
+    vm->checkpoint_first = 0;
+    vm->checkpoint_count = 0;
+    vm->checkpoint_base = NULL;
+
+    vm->input_log = NULL;
+    vm->input_length = 0;
+    vm->input_capacity = 0;
+    vm->input_position = 0;
+    vm->replay_end = 0;
+}
+
+// free memory owned by VM
+void free_vm(VM *vm) {
+    for (size_t i = 0; i < vm->checkpoint_count; i++) {
+        free(vm->checkpoints[(vm->checkpoint_first + i) % CHECKPOINT_COUNT].pages);
+    }
+    free(vm->checkpoint_base);
+    free(vm->input_log);
+    free(vm->timing.lines);
+    free(vm->timing.pc_hits);
+    free(vm->timing.pc_misses);
+    if (vm->disk.data) {
+        munmap(vm->disk.data, vm->disk.size);
+    }
 }
 
 // Opens program from file and loads it to memory it byte-by-byte
@@ -222,6 +558,62 @@ int load_program(VM *vm, const char *filename) {
     return 0;
 }
 
+// compare symbols by address for qsort
+int compare_symbols(const void *a, const void *b) {
+    const Symbol *sa = a, *sb = b;
+    return (int)sa->address - (int)sb->address;
+}
+
+// Opens symbol table produced by assembler (lines of "ADDR NAME")
+int load_symbols(VM *vm, const char *filename) {
+    FILE *file = fopen(filename, "r");
+
+    if (!file) {
+        perror("Failed to open symbol file");
+        return -1;
+    }
+
+    unsigned int address;
+    char name[SYMBOL_NAME_LENGTH];
+    while (vm->symbol_count < MAX_SYMBOLS && fscanf(file, "%x %31s", &address, name) == 2) {
+        Symbol *symbol = &vm->symbols[vm->symbol_count++];
+        strcpy(symbol->name, name);
+        symbol->address = address;
+    }
+    qsort(vm->symbols, vm->symbol_count, sizeof(Symbol), compare_symbols);
+
+    fclose(file);
+    return 0;
+}
+
+// find symbol by name, returns NULL if not found
+Symbol *find_symbol(VM *vm, const char *name) {
+    for (size_t i = 0; i < vm->symbol_count; i++) {
+        if (strcmp(vm->symbols[i].name, name) == 0) {
+            return &vm->symbols[i];
+        }
+    }
+    return NULL;
+}
+
+// print address with nearest preceding symbol, e.g. "0x0012 <loop+2>"
+void print_address(FILE *out, VM *vm, uint16_t address) {
+    fprintf(out, "0x%04X", address);
+    Symbol *nearest = NULL;
+    for (size_t i = 0; i < vm->symbol_count && vm->symbols[i].address <= address; i++) {
+        nearest = &vm->symbols[i];
+    }
+    // labels only describe program space, don't attach them to data addresses
+    if (!nearest || (address >= HEAP_ADDRESS && nearest->address != address)) {
+        return;
+    }
+    if (nearest->address == address) {
+        fprintf(out, " <%s>", nearest->name);
+    } else {
+        fprintf(out, " <%s+%d>", nearest->name, address - nearest->address);
+    }
+}
+
 // dump CPU state to console
 void dump_cpu(CPU *cpu) {
     fprintf(stderr, "PC: %X; SP: %X; BP: %X; Flags:", cpu->pc, cpu->sp, cpu->bp);
@@ -268,6 +660,51 @@ void dump_vm_verbose(VM *vm) {
     fprintf(stderr, "\n");
 }
 
+// host monotonic time in microseconds
+uint64_t host_microseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// print performance counter totals
+void print_stats(VM *vm) {
+    uint64_t elapsed = host_microseconds() - vm->start_time;
+    fprintf(stderr, "Instructions:   %llu\n", (unsigned long long)vm->instructions);
+    fprintf(stderr, "Memory ops:     %llu\n", (unsigned long long)vm->counters.memory_ops);
+    fprintf(stderr, "Branches taken: %llu\n", (unsigned long long)vm->counters.branches);
+    fprintf(stderr, "Calls:          %llu\n", (unsigned long long)vm->counters.calls);
+    fprintf(stderr, "Time:           %llu us", (unsigned long long)elapsed);
+    if (elapsed) {
+        fprintf(stderr, " (%.2f MIPS)", (double)vm->instructions / elapsed);
+    }
+    fprintf(stderr, "\n");
+
+    Allocator *allocator = &vm->allocator;
+    if (allocator->allocations || allocator->failures) {
+        // internal: rounding of live blocks to block size, external: free pages outside largest free run
+        uint32_t used_pages = 0, free_pages = 0, run = 0, largest_run = 0;
+        for (int page = 0; page < ALLOC_PAGE_COUNT; page++) {
+            if (allocator->page_kind[page] == ALLOC_PAGE_FREE) {
+                free_pages++;
+                run++;
+                largest_run = run > largest_run ? run : largest_run;
+            } else {
+                used_pages++;
+                run = 0;
+            }
+        }
+        fprintf(stderr, "Heap allocs:    %llu (%llu frees, %llu failed)\n", (unsigned long long)allocator->allocations,
+            (unsigned long long)allocator->frees, (unsigned long long)allocator->failures);
+        fprintf(stderr, "Heap live:      %u bytes in %u blocks (peak %u bytes)\n", allocator->live_bytes, allocator->live_blocks, allocator->peak_bytes);
+        fprintf(stderr, "Heap pages:     %u of %d used\n", used_pages, ALLOC_PAGE_COUNT);
+        fprintf(stderr, "Fragmentation:  internal %.1f%% (%u bytes), external %.1f%%\n",
+            allocator->live_slack ? 100.0 * allocator->live_slack / (allocator->live_bytes + allocator->live_slack) : 0.0,
+            allocator->live_slack,
+            free_pages ? 100.0 * (free_pages - largest_run) / free_pages : 0.0);
+    }
+}
+
 // set flags after substraction
 void set_flags_sub(CPU *cpu, uint16_t a, uint16_t b, uint16_t result) { 
     cpu->flags &= ~(ZERO_FLAG | CARRY_FLAG | SIGN_FLAG);   
@@ -296,6 +733,20 @@ void set_flags_add(CPU *cpu, uint16_t a, uint16_t b, uint16_t result) {
     }
 }
 
+// set flags from result, carry computed by caller
+void set_flags_carry(CPU *cpu, uint16_t result, int carry) { 
+    cpu->flags &= ~(ZERO_FLAG | CARRY_FLAG | SIGN_FLAG);   
+    if (result == 0) {
+        cpu->flags |= ZERO_FLAG;
+    }
+    if (result & MSB_MASK) { // MSB
+        cpu->flags |= SIGN_FLAG;
+    }
+    if (carry) {
+        cpu->flags |= CARRY_FLAG;
+    }
+}
+
 // execute ADD operation
 uint16_t cpu_add(CPU *cpu, uint16_t value1, uint16_t value2) {
     uint16_t result = value1 + value2;
@@ -310,27 +761,386 @@ uint16_t cpu_sub(CPU *cpu, uint16_t value1, uint16_t value2) {
     return result;
 }
 
-// execute MUL operation
-uint16_t cpu_mul(CPU *cpu, uint16_t value1, uint16_t value2) {
-    uint16_t result = value1 * value2;
-    set_flags_add(cpu, value1, value2, result);
+// execute ADC operation, adds carry flag
+uint16_t cpu_adc(CPU *cpu, uint16_t value1, uint16_t value2) {
+    uint32_t sum = (uint32_t)value1 + value2 + ((cpu->flags & CARRY_FLAG) ? 1 : 0);
+    uint16_t result = sum;
+    set_flags_carry(cpu, result, sum > 0xFFFF);
     return result;
 }
 
-// execute DIV operation
+// execute SBC operation, subtracts carry (borrow) flag
+uint16_t cpu_sbc(CPU *cpu, uint16_t value1, uint16_t value2) {
+    uint32_t subtrahend = (uint32_t)value2 + ((cpu->flags & CARRY_FLAG) ? 1 : 0);
+    uint16_t result = value1 - subtrahend;
+    set_flags_carry(cpu, result, value1 < subtrahend);
+    return result;
+}
+
+// execute widening MUL operation, carry is set if high word is nonzero
+uint32_t cpu_mulw(CPU *cpu, uint16_t value1, uint16_t value2) {
+    uint32_t result = (uint32_t)value1 * value2;
+    set_flags_carry(cpu, result, result > 0xFFFF);
+    return result;
+}
+
+// execute MUL operation, high word is dropped
+uint16_t cpu_mul(CPU *cpu, uint16_t value1, uint16_t value2) {
+    return cpu_mulw(cpu, value1, value2);
+}
+
+// execute DIV operation, divisor must be nonzero
 uint16_t cpu_div(CPU *cpu, uint16_t value1, uint16_t value2) {
-    uint16_t result;
-    if (value2 == 0) {
-        result = 0;
-    } else {
-        result = value1 / value2;        
-    }
-    set_flags_add(cpu, value1, value2, result);
+    uint16_t result = value1 / value2;
+    set_flags_carry(cpu, result, 0);
     return result;
 }
 
-// execute STOR operation
+// read char from console, logged so that re-execution reads the same input
+uint16_t read_input(VM *vm) {
+    if (!vm->checkpoint_interval) {
+        return getchar();
+    }
+    if (vm->input_position < vm->input_length) {
+        return vm->input_log[vm->input_position++];
+    }
+    if (vm->input_length == vm->input_capacity) {
+        size_t capacity = vm->input_capacity ? vm->input_capacity * 2 : 256;
+        uint16_t *log = realloc(vm->input_log, capacity * sizeof(uint16_t));
+        if (!log) {
+            fprintf(stderr, "Out of memory for input log!\n");
+            return getchar();
+        }
+        vm->input_log = log;
+        vm->input_capacity = capacity;
+    }
+    uint16_t value = getchar();
+    vm->input_log[vm->input_length++] = value;
+    vm->input_position++;
+    return value;
+}
+
+// write char to console, skipped while re-executing already printed instructions
+void write_output(VM *vm, uint8_t value) {
+    if (vm->instructions <= vm->replay_end) {
+        return;
+    }
+    putchar(value);
+}
+
+// read 32-bit counter through its low/high word registers
+uint16_t read_counter(VM *vm, uint8_t index, uint16_t address, uint16_t base, uint64_t value) {
+    if (address == base) {
+        vm->counter_latches[index] = (value >> 16) & 0xFFFF;
+        return value & 0xFFFF;
+    }
+    return vm->counter_latches[index];
+}
+
+// check if address is an I/O register computed on read, rest of I/O window is plain memory
+int is_mmio_register(uint16_t address) {
+    switch (address) {
+        case RX_ADDRESS:
+        case INSTRUCTIONS_ADDRESS:
+        case INSTRUCTIONS_ADDRESS + 2:
+        case TIMER_ADDRESS:
+        case TIMER_ADDRESS + 2:
+        case MEMORY_OPS_ADDRESS:
+        case MEMORY_OPS_ADDRESS + 2:
+        case BRANCHES_ADDRESS:
+        case BRANCHES_ADDRESS + 2:
+        case CALLS_ADDRESS:
+        case CALLS_ADDRESS + 2:
+        case DISK_SIZE_ADDRESS:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// read from mapped I/O register
+uint16_t read_mmio(VM *vm, uint16_t address) {
+    switch (address) {
+        case RX_ADDRESS:
+            return read_input(vm);
+        case INSTRUCTIONS_ADDRESS:
+        case INSTRUCTIONS_ADDRESS + 2:
+            return read_counter(vm, 0, address, INSTRUCTIONS_ADDRESS, vm->instructions);
+        case TIMER_ADDRESS:
+        case TIMER_ADDRESS + 2:
+            return read_counter(vm, 1, address, TIMER_ADDRESS, host_microseconds() - vm->start_time);
+        case MEMORY_OPS_ADDRESS:
+        case MEMORY_OPS_ADDRESS + 2:
+            return read_counter(vm, 2, address, MEMORY_OPS_ADDRESS, vm->counters.memory_ops);
+        case BRANCHES_ADDRESS:
+        case BRANCHES_ADDRESS + 2:
+            return read_counter(vm, 3, address, BRANCHES_ADDRESS, vm->counters.branches);
+        case CALLS_ADDRESS:
+        case CALLS_ADDRESS + 2:
+            return read_counter(vm, 4, address, CALLS_ADDRESS, vm->counters.calls);
+        case DISK_SIZE_ADDRESS:
+            return vm->disk.sectors > 0xFFFF ? 0xFFFF : vm->disk.sectors;
+        default:
+            return (vm->memory[address + 1] << 8) | vm->memory[address];
+    }
+}
+
+// enable timing model with given cache geometry and default latencies
+int init_timing(VM *vm, uint16_t sets, uint16_t ways, uint16_t line_size) {
+    Timing *timing = &vm->timing;
+    if (sets == 0 || ways == 0 || line_size == 0) {
+        fprintf(stderr, "Invalid cache configuration!\n");
+        return -1;
+    }
+    timing->sets = sets;
+    timing->ways = ways;
+    timing->line_size = line_size;
+    timing->lines = calloc((size_t)sets * ways, sizeof(CacheLine));
+    timing->pc_hits = calloc(HEAP_ADDRESS, sizeof(uint32_t));
+    timing->pc_misses = calloc(HEAP_ADDRESS, sizeof(uint32_t));
+    if (!timing->lines || !timing->pc_hits || !timing->pc_misses) {
+        fprintf(stderr, "Out of memory for timing model!\n");
+        return -1;
+    }
+
+    memset(timing->latency, 1, sizeof(timing->latency));
+    timing->latency[OPCODE_MULR] = timing->latency[OPCODE_MULI] = timing->latency[OPCODE_MULWR] = 4;
+    timing->latency[OPCODE_DIVR] = timing->latency[OPCODE_DIVI] = timing->latency[OPCODE_DIVMODR] = 20;
+    timing->branch_penalty = DEFAULT_BRANCH_PENALTY;
+    timing->hit_latency = DEFAULT_HIT_LATENCY;
+    timing->miss_latency = DEFAULT_MISS_LATENCY;
+    timing->enabled = 1;
+    return 0;
+}
+
+// load latencies from file, lines of "NAME CYCLES",
+// NAME is opcode name (e.g. MULR) or BRANCH, HIT, MISS
+int load_latencies(VM *vm, const char *filename) {
+    FILE *file = fopen(filename, "r");
+
+    if (!file) {
+        perror("Failed to open latency file");
+        return -1;
+    }
+
+    char name[SYMBOL_NAME_LENGTH];
+    unsigned int cycles;
+    while (fscanf(file, "%31s %u", name, &cycles) == 2) {
+        if (strcmp(name, "BRANCH") == 0) {
+            vm->timing.branch_penalty = cycles;
+        } else if (strcmp(name, "HIT") == 0) {
+            vm->timing.hit_latency = cycles;
+        } else if (strcmp(name, "MISS") == 0) {
+            vm->timing.miss_latency = cycles;
+        } else {
+            int found = 0;
+            for (int opcode = 0; opcode < 256; opcode++) {
+                if (opcode_table[opcode].name && strcmp(opcode_table[opcode].name, name) == 0) {
+                    vm->timing.latency[opcode] = cycles;
+                    found = 1;
+                }
+            }
+            if (!found) {
+                fprintf(stderr, "Unknown opcode in latency file: %s\n", name);
+                fclose(file);
+                return -1;
+            }
+        }
+    }
+
+    fclose(file);
+    return 0;
+}
+
+// simulate data cache access, returns 1 on hit
+int cache_access(Timing *timing, uint16_t address) {
+    uint16_t line = address / timing->line_size;
+    uint16_t tag = line / timing->sets;
+    CacheLine *set = &timing->lines[(line % timing->sets) * timing->ways];
+    CacheLine *victim = &set[0];
+
+    for (uint16_t way = 0; way < timing->ways; way++) {
+        if (set[way].valid && set[way].tag == tag) {
+            set[way].last_use = timing->cycles;
+            return 1;
+        }
+        if (!set[way].valid) {
+            victim = &set[way];
+        } else if (victim->valid && set[way].last_use < victim->last_use) {
+            victim = &set[way];
+        }
+    }
+    victim->valid = 1;
+    victim->tag = tag;
+    victim->last_use = timing->cycles;
+    return 0;
+}
+
+// account cycles of executed instruction
+void account_timing(Timing *timing, uint8_t opcode, uint16_t pc, int32_t mem_address, int branch_taken) {
+    timing->cycles += timing->latency[opcode];
+    if (branch_taken) {
+        timing->cycles += timing->branch_penalty;
+    }
+    if (mem_address >= MMIO_ADDRESS && mem_address < STACK_END) {
+        // I/O is not cached
+        timing->cycles += timing->miss_latency;
+    } else if (mem_address >= 0) {
+        if (cache_access(timing, mem_address)) {
+            timing->hits++;
+            timing->pc_hits[pc]++;
+            timing->cycles += timing->hit_latency;
+        } else {
+            timing->misses++;
+            timing->pc_misses[pc]++;
+            timing->cycles += timing->miss_latency;
+        }
+    }
+}
+
+// print timing model results with cache misses per instruction
+void print_timing(VM *vm) {
+    Timing *timing = &vm->timing;
+    uint64_t accesses = timing->hits + timing->misses;
+
+    fprintf(stderr, "Cycles:         %llu", (unsigned long long)timing->cycles);
+    if (vm->instructions) {
+        fprintf(stderr, " (CPI %.2f)", (double)timing->cycles / vm->instructions);
+    }
+    fprintf(stderr, "\nCache:          %u sets x %u ways x %u bytes\n", timing->sets, timing->ways, timing->line_size);
+    fprintf(stderr, "Cache hits:     %llu\n", (unsigned long long)timing->hits);
+    fprintf(stderr, "Cache misses:   %llu", (unsigned long long)timing->misses);
+    if (accesses) {
+        fprintf(stderr, " (%.1f%%)", 100.0 * timing->misses / accesses);
+    }
+    fprintf(stderr, "\n");
+
+    // top instructions by misses, selection by repeated scan
+    uint32_t limit = UINT32_MAX;
+    int shown = 0;
+    while (shown < TIMING_REPORT_COUNT) {
+        uint32_t best = 0;
+        for (uint16_t pc = 0; pc < HEAP_ADDRESS; pc++) {
+            if (timing->pc_misses[pc] > best && timing->pc_misses[pc] < limit) {
+                best = timing->pc_misses[pc];
+            }
+        }
+        if (best == 0) {
+            break;
+        }
+        if (shown == 0) {
+            fprintf(stderr, "Misses by instruction:\n");
+        }
+        for (uint16_t pc = 0; pc < HEAP_ADDRESS && shown < TIMING_REPORT_COUNT; pc++) {
+            if (timing->pc_misses[pc] == best) {
+                fprintf(stderr, "  ");
+                print_address(stderr, vm, pc);
+                fprintf(stderr, ": %u misses, %u hits\n", timing->pc_misses[pc], timing->pc_hits[pc]);
+                shown++;
+            }
+        }
+        limit = best;
+    }
+}
+
+// check watchpoints on a written address, only called for watched pages
+int check_watchpoints(VM *vm, uint16_t address) {
+    for (uint8_t i = 0; i < vm->watchpoint_count; i++) {
+        if (vm->watchpoints[i] == address) {
+            vm->watch_hit = address;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// mark memory range written by a device or system call, returns 1 if a watchpoint was hit
+int mark_written(VM *vm, uint16_t address, uint32_t length) {
+    int hit = 0;
+    if (length) {
+        memset(vm->dirty_pages + address / PAGE_SIZE, 1, (address + length - 1) / PAGE_SIZE - address / PAGE_SIZE + 1);
+    }
+    for (uint8_t i = 0; i < vm->watchpoint_count && !hit; i++) {
+        if (vm->watchpoints[i] >= address && vm->watchpoints[i] < address + length) {
+            vm->watch_hit = vm->watchpoints[i];
+            hit = 1;
+        }
+    }
+    return hit;
+}
+
+// attach block device, file is mapped shared so disk writes reach it
+int attach_disk(VM *vm, const char *filename) {
+    int fd = open(filename, O_RDWR);
+    if (fd == -1) {
+        perror("Failed to open disk image");
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        perror("Failed to read disk image");
+        close(fd);
+        return -1;
+    }
+    if (st.st_size < DISK_SECTOR_SIZE) {
+        fprintf(stderr, "Disk image is smaller than one sector: %s\n", filename);
+        close(fd);
+        return -1;
+    }
+    void *data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("Failed to map disk image");
+        return -1;
+    }
+    vm->disk.data = data;
+    vm->disk.size = st.st_size;
+    vm->disk.sectors = st.st_size / DISK_SECTOR_SIZE;
+    return 0;
+}
+
+// execute block device command: whole transfer is a single copy, done when store completes.
+// Invalid commands and out of range transfers set error status instead of faulting.
+// Returns 1 if a watchpoint was hit by transferred data.
+int exec_disk_command(VM *vm, uint16_t command) {
+    uint16_t sector = vm->memory[DISK_SECTOR_ADDRESS] | (vm->memory[DISK_SECTOR_ADDRESS + 1] << 8);
+    uint16_t buffer = vm->memory[DISK_BUFFER_ADDRESS] | (vm->memory[DISK_BUFFER_ADDRESS + 1] << 8);
+    uint16_t count = vm->memory[DISK_COUNT_ADDRESS] | (vm->memory[DISK_COUNT_ADDRESS + 1] << 8);
+    uint32_t length = (uint32_t)count * DISK_SECTOR_SIZE;
+    uint8_t status = DISK_STATUS_ERROR;
+    int hit = 0;
+
+    if (!vm->disk.data) {
+        if (vm->debug) {
+            fprintf(stderr, "Disk command %d: no disk attached\n", command);
+        }
+    } else if ((uint32_t)sector + count > vm->disk.sectors || buffer < HEAP_ADDRESS || buffer + length > MMIO_ADDRESS) {
+        if (vm->debug) {
+            fprintf(stderr, "Disk command %d: sectors %d+%d to 0x%04X out of range\n", command, sector, count, buffer);
+        }
+    } else if (command == DISK_COMMAND_READ) {
+        memcpy(vm->memory + buffer, vm->disk.data + (size_t)sector * DISK_SECTOR_SIZE, length);
+        hit = mark_written(vm, buffer, length);
+        status = DISK_STATUS_DONE;
+    } else if (command == DISK_COMMAND_WRITE) {
+        memcpy(vm->disk.data + (size_t)sector * DISK_SECTOR_SIZE, vm->memory + buffer, length);
+        status = DISK_STATUS_DONE;
+    } else if (vm->debug) {
+        fprintf(stderr, "Unknown disk command %d\n", command);
+    }
+
+    if (vm->debug && status == DISK_STATUS_DONE) {
+        fprintf(stderr, "Disk %s sectors %d+%d at 0x%04X\n", command == DISK_COMMAND_READ ? "read" : "write", sector, count, buffer);
+    }
+    vm->memory[DISK_STATUS_ADDRESS] = status;
+    vm->memory[DISK_STATUS_ADDRESS + 1] = 0;
+    vm->dirty_pages[DISK_STATUS_ADDRESS / PAGE_SIZE] = 1;
+    return hit;
+}
+
+// execute STOR operation, returns 1 if a watchpoint was hit
 int exec_stor(VM *vm, uint16_t address, uint16_t value) {
+    vm->counters.memory_ops++;
     if (address < HEAP_ADDRESS) {
         fprintf(stderr, "Address out of bounds! Can't write into program space.\n");
         return -1;
@@ -347,26 +1157,35 @@ int exec_stor(VM *vm, uint16_t address, uint16_t value) {
         if (vm->debug) {
             fprintf(stderr, "Printing %c (ASCII %d)\n", value, value);
         }
-        putchar(value);
+        write_output(vm, value);
+    } else if (address == DISK_COMMAND_ADDRESS) {
+        return exec_disk_command(vm, value);
     } else {
     vm->memory[address] = value & LOW_BYTE_MASK;
     vm->memory[address + 1] = (value & HIGH_BYTE_MASK) >> 8;
+    vm->dirty_pages[address / PAGE_SIZE] = 1;
+    vm->dirty_pages[(uint16_t)(address + 1) / PAGE_SIZE] = 1;
+    if (vm->watch_pages[address / PAGE_SIZE] || vm->watch_pages[(uint16_t)(address + 1) / PAGE_SIZE]) {
+        return check_watchpoints(vm, address) | check_watchpoints(vm, address + 1);
+    }
     }
     return 0;
 }
 
 // execute LOAD operation
 int exec_load(VM *vm, uint8_t reg, uint16_t address) {
-    if (address == RX_ADDRESS) {
-        vm->cpu.registers[reg] = getchar();
+    vm->counters.memory_ops++;
+    if (is_mmio_register(address)) {
+        vm->cpu.registers[reg] = read_mmio(vm, address);
     } else {
     vm->cpu.registers[reg] = (vm->memory[address+1] << 8) | vm->memory[address];
     }
     return 0;
 }
 
-// execute STORB operation
+// execute STORB operation, returns 1 if a watchpoint was hit
 int exec_storb(VM *vm, uint16_t address, uint8_t value) {
+    vm->counters.memory_ops++;
     if (address < HEAP_ADDRESS) {
         fprintf(stderr, "Address out of bounds! Can't write into program space.\n");
         return -1;
@@ -379,17 +1198,24 @@ int exec_storb(VM *vm, uint16_t address, uint8_t value) {
         if (vm->debug) {
             fprintf(stderr, "Printing %c (ASCII %d)\n", value, value);
         }
-        putchar(value);
+        write_output(vm, value);
+    } else if (address == DISK_COMMAND_ADDRESS) {
+        return exec_disk_command(vm, value);
     } else {
     vm->memory[address] = value & LOW_BYTE_MASK;
+    vm->dirty_pages[address / PAGE_SIZE] = 1;
+    if (vm->watch_pages[address / PAGE_SIZE]) {
+        return check_watchpoints(vm, address);
+    }
     }
     return 0;
 }
 
 // execute LOADB operation
 int exec_loadb(VM *vm, uint8_t reg, uint16_t address) {
-    if (address == RX_ADDRESS) {
-        vm->cpu.registers[reg] = getchar();
+    vm->counters.memory_ops++;
+    if (is_mmio_register(address)) {
+        vm->cpu.registers[reg] = read_mmio(vm, address) & LOW_BYTE_MASK;
     } else {
     vm->cpu.registers[reg] = vm->memory[address];
     }
@@ -398,60 +1224,631 @@ int exec_loadb(VM *vm, uint8_t reg, uint16_t address) {
 
 // execute PUSH operation
 int exec_push(VM *vm, uint16_t value) {
+    vm->counters.memory_ops++;
     if (vm->cpu.sp - 2 < STACK_END) {
         fprintf(stderr, "Stack overflow!\n");
         return -1;
     }
     vm->memory[vm->cpu.sp] = value & LOW_BYTE_MASK;
     vm->memory[vm->cpu.sp + 1] = (value & HIGH_BYTE_MASK) >> 8;
+    vm->dirty_pages[vm->cpu.sp / PAGE_SIZE] = 1;
+    vm->dirty_pages[(uint16_t)(vm->cpu.sp + 1) / PAGE_SIZE] = 1;
     vm->cpu.sp -= 2;
     return 0;
 }
 
 // execute POP operation
 int exec_pop(VM *vm, uint8_t reg) {
+    vm->counters.memory_ops++;
     if (vm->cpu.sp > MEMORY_SIZE - 2) {
         fprintf(stderr, "Stack underflow!\n");
         return -1;
     }
-    vm->cpu.sp += 2;
-    vm->cpu.registers[reg] = vm->memory[vm->cpu.sp] | (vm->memory[vm->cpu.sp + 1] << 8) ;
+    vm->cpu.sp += 2;
+    vm->cpu.registers[reg] = vm->memory[vm->cpu.sp] | (vm->memory[vm->cpu.sp + 1] << 8) ;
+    return 0;
+}
+
+// execute store into stack frame (BP-relative), returns 1 if a watchpoint was hit
+int exec_stor_frame(VM *vm, uint16_t address, uint16_t value, uint8_t size) {
+    vm->counters.memory_ops++;
+    if (address < STACK_END || address > MEMORY_SIZE - size) {
+        fprintf(stderr, "Address out of bounds! Frame address is outside stack.\n");
+        return -1;
+    }
+    vm->memory[address] = value & LOW_BYTE_MASK;
+    if (size == 2) {
+        vm->memory[address + 1] = (value & HIGH_BYTE_MASK) >> 8;
+    }
+    vm->dirty_pages[address / PAGE_SIZE] = 1;
+    vm->dirty_pages[(address + size - 1) / PAGE_SIZE] = 1;
+    if (vm->watch_pages[address / PAGE_SIZE] || vm->watch_pages[(address + size - 1) / PAGE_SIZE]) {
+        return check_watchpoints(vm, address) | (size == 2 && check_watchpoints(vm, address + 1));
+    }
+    return 0;
+}
+
+// execute ENTER operation: push BP, BP = SP, reserve locals
+int exec_enter(VM *vm, uint16_t size) {
+    if (vm->cpu.sp - 2 - size < STACK_END) {
+        fprintf(stderr, "Stack overflow!\n");
+        return -1;
+    }
+    if (exec_push(vm, vm->cpu.bp) == -1) {
+        return -1;
+    }
+    vm->cpu.bp = vm->cpu.sp;
+    vm->cpu.sp -= size;
+    return 0;
+}
+
+// execute LEAVE operation: SP = BP, pop BP
+int exec_leave(VM *vm) {
+    vm->counters.memory_ops++;
+    if (vm->cpu.bp > MEMORY_SIZE - 4) {
+        fprintf(stderr, "Stack underflow!\n");
+        return -1;
+    }
+    vm->cpu.sp = vm->cpu.bp + 2;
+    vm->cpu.bp = vm->memory[vm->cpu.sp] | (vm->memory[vm->cpu.sp + 1] << 8);
+    return 0;
+}
+
+// execute DIV operation, faults on division by zero
+int exec_div(VM *vm, uint8_t reg, uint16_t divisor) {
+    if (divisor == 0) {
+        fprintf(stderr, "Division by zero!\n");
+        return -1;
+    }
+    vm->cpu.registers[reg] = cpu_div(&vm->cpu, vm->cpu.registers[reg], divisor);
+    return 0;
+}
+
+// execute MULW operation: low word to reg1, high word to reg2
+// if both are the same register, low word wins (squaring)
+int exec_mulw(VM *vm, uint8_t reg1, uint8_t reg2) {
+    uint32_t product = cpu_mulw(&vm->cpu, vm->cpu.registers[reg1], vm->cpu.registers[reg2]);
+    vm->cpu.registers[reg2] = product >> 16;
+    vm->cpu.registers[reg1] = product & 0xFFFF;
+    return 0;
+}
+
+// execute DIVMOD operation: quotient to reg1, remainder to reg2
+// if both are the same register, quotient wins
+int exec_divmod(VM *vm, uint8_t reg1, uint8_t reg2) {
+    uint16_t dividend = vm->cpu.registers[reg1];
+    uint16_t divisor = vm->cpu.registers[reg2];
+    if (divisor == 0) {
+        fprintf(stderr, "Division by zero!\n");
+        return -1;
+    }
+    vm->cpu.registers[reg2] = dividend % divisor;
+    vm->cpu.registers[reg1] = cpu_div(&vm->cpu, dividend, divisor);
+    return 0;
+}
+
+// execute CALL operation
+int exec_call(VM *vm, uint16_t address) {
+    vm->counters.calls++;
+    if (vm->cpu.sp - 2  < STACK_END) {
+        fprintf(stderr, "Stack overflow!\n");
+        return -1;
+    }
+    vm->memory[vm->cpu.sp] = vm->cpu.pc & LOW_BYTE_MASK;
+    vm->memory[vm->cpu.sp + 1] = (vm->cpu.pc & HIGH_BYTE_MASK) >> 8;
+    vm->dirty_pages[vm->cpu.sp / PAGE_SIZE] = 1;
+    vm->dirty_pages[(uint16_t)(vm->cpu.sp + 1) / PAGE_SIZE] = 1;
+    vm->cpu.sp -= 2;
+    vm->cpu.pc = address;
+    return 0;
+}
+
+// execute RET operation
+int exec_ret(VM *vm) {
+    if (vm->cpu.sp > MEMORY_SIZE - 2) {
+        fprintf(stderr, "Stack underflow!\n");
+        return -1;
+    }
+    vm->cpu.sp += 2;
+    vm->cpu.pc = vm->memory[vm->cpu.sp] | (vm->memory[vm->cpu.sp + 1] << 8) ;
+    return 0;
+}
+
+// check that system call buffer is inside heap
+int check_heap_range(uint16_t address, uint32_t length) {
+    if (address < HEAP_ADDRESS || address + length > MMIO_ADDRESS) {
+        fprintf(stderr, "Address out of bounds! System call buffer must be in heap.\n");
+        return -1;
+    }
+    return 0;
+}
+
+// print host string through serial output
+void write_string(VM *vm, const char *string) {
+    while (*string) {
+        write_output(vm, *string++);
+    }
+}
+
+// SYS_PUTS: print zero-terminated string at R0
+int sys_puts(VM *vm) {
+    uint16_t address = vm->cpu.registers[0];
+    const uint8_t *end = memchr(vm->memory + address, 0, MEMORY_SIZE - address);
+    if (!end) {
+        fprintf(stderr, "String is not terminated!\n");
+        return -1;
+    }
+    for (const uint8_t *c = vm->memory + address; c < end; c++) {
+        write_output(vm, *c);
+    }
+    return 0;
+}
+
+// SYS_PUTU: print R0 as unsigned decimal
+int sys_putu(VM *vm) {
+    char buffer[8];
+    snprintf(buffer, sizeof(buffer), "%u", vm->cpu.registers[0]);
+    write_string(vm, buffer);
+    return 0;
+}
+
+// SYS_PUTI: print R0 as signed decimal
+int sys_puti(VM *vm) {
+    char buffer[8];
+    snprintf(buffer, sizeof(buffer), "%d", (int16_t)vm->cpu.registers[0]);
+    write_string(vm, buffer);
+    return 0;
+}
+
+// SYS_PUTX: print R0 as hex
+int sys_putx(VM *vm) {
+    char buffer[8];
+    snprintf(buffer, sizeof(buffer), "%X", vm->cpu.registers[0]);
+    write_string(vm, buffer);
+    return 0;
+}
+
+// parse number at R0 until first non-digit: R0 - value, R1 - chars consumed.
+// Carry is set if there are no digits or value is out of range, R0 is 0 then.
+void sys_parse(VM *vm, uint32_t base, int is_signed) {
+    uint32_t address = vm->cpu.registers[0];
+    uint32_t start = address;
+    uint32_t value = 0;
+    int negative = 0, digits = 0, error = 0;
+
+    if (is_signed && address < MEMORY_SIZE && (vm->memory[address] == '-' || vm->memory[address] == '+')) {
+        negative = vm->memory[address] == '-';
+        address++;
+    }
+    if (base == 16 && address + 1 < MEMORY_SIZE && vm->memory[address] == '0' && (vm->memory[address + 1] | 0x20) == 'x') {
+        address += 2;
+    }
+    uint32_t limit = is_signed ? (negative ? 0x8000 : 0x7FFF) : 0xFFFF;
+    for (; address < MEMORY_SIZE; address++, digits++) {
+        uint8_t c = vm->memory[address];
+        uint32_t digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (base == 16 && (c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+            digit = (c | 0x20) - 'a' + 10;
+        } else {
+            break;
+        }
+        if (!error) {
+            value = value * base + digit;
+            error = value > limit;
+        }
+    }
+    if (!digits) {
+        error = 1;
+        address = start;
+    }
+
+    vm->cpu.registers[0] = error ? 0 : (negative ? -value : value);
+    vm->cpu.registers[1] = address - start;
+    set_flags_carry(&vm->cpu, vm->cpu.registers[0], error);
+}
+
+// SYS_PARSEU: parse unsigned decimal at R0
+int sys_parseu(VM *vm) {
+    sys_parse(vm, 10, 0);
+    return 0;
+}
+
+// SYS_PARSEI: parse signed decimal at R0, with optional sign
+int sys_parsei(VM *vm) {
+    sys_parse(vm, 10, 1);
+    return 0;
+}
+
+// SYS_PARSEX: parse hex at R0, with optional 0x prefix
+int sys_parsex(VM *vm) {
+    sys_parse(vm, 16, 0);
+    return 0;
+}
+
+// SYS_GETS: read line (without newline) to buffer R0 of R1 bytes, zero-terminated.
+// Longer lines are cut, rest is left for next read. R1 - length
+int sys_gets(VM *vm) {
+    uint16_t buffer = vm->cpu.registers[0];
+    uint16_t size = vm->cpu.registers[1];
+    uint16_t length = 0;
+    if (!size) {
+        return 0;
+    }
+    if (check_heap_range(buffer, size) == -1) {
+        return -1;
+    }
+    while (length + 1 < size) {
+        uint16_t c = read_input(vm);
+        if (c == '\n' || c == (uint16_t)EOF) {
+            break;
+        }
+        vm->memory[buffer + length++] = c;
+    }
+    vm->memory[buffer + length] = 0;
+    vm->cpu.registers[1] = length;
+    return mark_written(vm, buffer, length + 1);
+}
+
+// SYS_MEMSET: fill R2 bytes at R0 with R1
+int sys_memset(VM *vm) {
+    uint16_t address = vm->cpu.registers[0];
+    uint16_t count = vm->cpu.registers[2];
+    if (check_heap_range(address, count) == -1) {
+        return -1;
+    }
+    memset(vm->memory + address, vm->cpu.registers[1] & LOW_BYTE_MASK, count);
+    return mark_written(vm, address, count);
+}
+
+typedef int (*SysService)(VM *vm);
+
+SysService sys_table[SYS_COUNT] = {
+    [SYS_PUTS]   = sys_puts,
+    [SYS_PUTU]   = sys_putu,
+    [SYS_PUTI]   = sys_puti,
+    [SYS_PUTX]   = sys_putx,
+    [SYS_PARSEU] = sys_parseu,
+    [SYS_PARSEI] = sys_parsei,
+    [SYS_PARSEX] = sys_parsex,
+    [SYS_GETS]   = sys_gets,
+    [SYS_MEMSET] = sys_memset,
+};
+
+// execute SYS operation, returns -1 on fault, 1 if a watchpoint was hit
+int exec_sys(VM *vm, uint16_t service) {
+    if (service >= SYS_COUNT) {
+        fprintf(stderr, "Unknown system call %d!\n", service);
+        return -1;
+    }
+    return sys_table[service](vm);
+}
+
+// execute ALLOC operation: reg - address of block of at least size bytes.
+// On failure reg is 0 and Carry is set. Blocks are not cleared.
+int exec_alloc(VM *vm, uint8_t reg, uint16_t size) {
+    Allocator *allocator = &vm->allocator;
+    uint16_t address = 0;
+    uint32_t block_size = 0;
+    int class = 0;
+    while (class < ALLOC_CLASS_COUNT && (ALLOC_MIN_SIZE << class) < size) {
+        class++;
+    }
+
+    if (class < ALLOC_CLASS_COUNT) {
+        // small block: first page of this class with a free slot, or a new page
+        uint32_t slots = PAGE_SIZE / (ALLOC_MIN_SIZE << class);
+        uint32_t full = slots == 32 ? UINT32_MAX : (1u << slots) - 1;
+        int page = -1;
+        for (int i = 0; i < ALLOC_PAGE_COUNT && page < 0; i++) {
+            if (allocator->page_kind[i] == class + 1 && allocator->slots_used[i] != full) {
+                page = i;
+            }
+        }
+        for (int i = 0; i < ALLOC_PAGE_COUNT && page < 0; i++) {
+            if (allocator->page_kind[i] == ALLOC_PAGE_FREE) {
+                page = i;
+                allocator->page_kind[i] = class + 1;
+                allocator->slots_used[i] = 0;
+            }
+        }
+        if (page >= 0) {
+            uint32_t slot = 0;
+            while (allocator->slots_used[page] & (1u << slot)) {
+                slot++;
+            }
+            allocator->slots_used[page] |= 1u << slot;
+            block_size = ALLOC_MIN_SIZE << class;
+            address = ALLOC_ARENA_ADDRESS + page * PAGE_SIZE + slot * block_size;
+        }
+    } else {
+        // large block: first run of free pages long enough
+        uint32_t pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+        uint32_t run = 0;
+        for (int i = 0; i < ALLOC_PAGE_COUNT; i++) {
+            run = allocator->page_kind[i] == ALLOC_PAGE_FREE ? run + 1 : 0;
+            if (run == pages) {
+                int first = i - pages + 1;
+                memset(allocator->page_kind + first, ALLOC_PAGE_CONT, pages);
+                allocator->page_kind[first] = ALLOC_PAGE_LARGE;
+                allocator->page_run[first] = pages;
+                block_size = pages * PAGE_SIZE;
+                address = ALLOC_ARENA_ADDRESS + first * PAGE_SIZE;
+                break;
+            }
+        }
+    }
+
+    if (address) {
+        allocator->allocations++;
+        allocator->live_blocks++;
+        allocator->slack[(address - ALLOC_ARENA_ADDRESS) / ALLOC_MIN_SIZE] = block_size - size;
+        allocator->live_bytes += size;
+        allocator->live_slack += block_size - size;
+        if (allocator->live_bytes > allocator->peak_bytes) {
+            allocator->peak_bytes = allocator->live_bytes;
+        }
+    } else {
+        allocator->failures++;
+    }
+    vm->cpu.registers[reg] = address;
+    set_flags_carry(&vm->cpu, address, !address);
+    return 0;
+}
+
+// execute FREE operation, freeing 0 does nothing.
+// Address that is not an allocated block is a fault.
+int exec_free(VM *vm, uint16_t address) {
+    Allocator *allocator = &vm->allocator;
+    if (address == 0) {
+        return 0;
+    }
+    if (address < ALLOC_ARENA_ADDRESS || address >= ALLOC_ARENA_END) {
+        fprintf(stderr, "Invalid free! Address is outside allocator arena.\n");
+        return -1;
+    }
+    uint32_t page = (address - ALLOC_ARENA_ADDRESS) / PAGE_SIZE;
+    uint32_t offset = (address - ALLOC_ARENA_ADDRESS) % PAGE_SIZE;
+    uint8_t kind = allocator->page_kind[page];
+    uint32_t block_size;
+
+    if (kind >= 1 && kind <= ALLOC_CLASS_COUNT) {
+        block_size = ALLOC_MIN_SIZE << (kind - 1);
+        uint32_t slot = offset / block_size;
+        if (offset % block_size || !(allocator->slots_used[page] & (1u << slot))) {
+            fprintf(stderr, "Invalid free! Block is not allocated.\n");
+            return -1;
+        }
+        allocator->slots_used[page] &= ~(1u << slot);
+        if (!allocator->slots_used[page]) {
+            allocator->page_kind[page] = ALLOC_PAGE_FREE;
+        }
+    } else if (kind == ALLOC_PAGE_LARGE && offset == 0) {
+        block_size = allocator->page_run[page] * PAGE_SIZE;
+        memset(allocator->page_kind + page, ALLOC_PAGE_FREE, allocator->page_run[page]);
+    } else {
+        fprintf(stderr, "Invalid free! Block is not allocated.\n");
+        return -1;
+    }
+
+    uint8_t slack = allocator->slack[(address - ALLOC_ARENA_ADDRESS) / ALLOC_MIN_SIZE];
+    allocator->frees++;
+    allocator->live_blocks--;
+    allocator->live_bytes -= block_size - slack;
+    allocator->live_slack -= slack;
+    return 0;
+}
+
+// find breakpoint index by address, returns -1 if not found
+int find_breakpoint(VM *vm, uint16_t address) {
+    for (uint8_t i = 0; i < vm->breakpoint_count; i++) {
+        if (vm->breakpoints[i].address == address) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// set breakpoint by patching BRK opcode over the instruction
+int add_breakpoint(VM *vm, uint16_t address) {
+    if (address >= HEAP_ADDRESS) {
+        fprintf(stderr, "Breakpoint is outside program space!\n");
+        return -1;
+    }
+    if (find_breakpoint(vm, address) >= 0) {
+        return 0;
+    }
+    if (vm->breakpoint_count == MAX_BREAKPOINTS) {
+        fprintf(stderr, "Too many breakpoints!\n");
+        return -1;
+    }
+    Breakpoint *bp = &vm->breakpoints[vm->breakpoint_count++];
+    bp->address = address;
+    bp->original = vm->memory[address];
+    vm->memory[address] = OPCODE_BRK;
+    return 0;
+}
+
+// remove breakpoint and restore original opcode
+int remove_breakpoint(VM *vm, uint16_t address) {
+    int i = find_breakpoint(vm, address);
+    if (i < 0) {
+        fprintf(stderr, "No breakpoint at %X!\n", address);
+        return -1;
+    }
+    vm->memory[address] = vm->breakpoints[i].original;
+    vm->breakpoints[i] = vm->breakpoints[--vm->breakpoint_count];
+    return 0;
+}
+
+// set watchpoint on memory writes to address
+int add_watchpoint(VM *vm, uint16_t address) {
+    for (uint8_t i = 0; i < vm->watchpoint_count; i++) {
+        if (vm->watchpoints[i] == address) {
+            return 0;
+        }
+    }
+    if (vm->watchpoint_count == MAX_WATCHPOINTS) {
+        fprintf(stderr, "Too many watchpoints!\n");
+        return -1;
+    }
+    vm->watchpoints[vm->watchpoint_count++] = address;
+    vm->watch_pages[address / PAGE_SIZE]++;
+    return 0;
+}
+
+// remove watchpoint from address
+int remove_watchpoint(VM *vm, uint16_t address) {
+    for (uint8_t i = 0; i < vm->watchpoint_count; i++) {
+        if (vm->watchpoints[i] == address) {
+            vm->watchpoints[i] = vm->watchpoints[--vm->watchpoint_count];
+            vm->watch_pages[address / PAGE_SIZE]--;
+            return 0;
+        }
+    }
+    fprintf(stderr, "No watchpoint at %X!\n", address);
+    return -1;
+}
+
+// copy checkpoint pages into memory image
+void apply_checkpoint_pages(uint8_t *memory, Checkpoint *checkpoint) {
+    for (uint16_t i = 0; i < checkpoint->page_count; i++) {
+        memcpy(memory + checkpoint->page_numbers[i] * PAGE_SIZE, checkpoint->pages + i * PAGE_SIZE, PAGE_SIZE);
+    }
+}
+
+// get checkpoint by age, 0 - oldest
+Checkpoint *get_checkpoint(VM *vm, size_t i) {
+    return &vm->checkpoints[(vm->checkpoint_first + i) % CHECKPOINT_COUNT];
+}
+
+// enable periodic checkpoints every interval instructions
+int init_checkpoints(VM *vm, uint64_t interval) {
+    vm->checkpoint_base = malloc(MEMORY_SIZE);
+    if (!vm->checkpoint_base) {
+        fprintf(stderr, "Out of memory for checkpoints!\n");
+        return -1;
+    }
+    vm->checkpoint_interval = interval;
+    vm->next_checkpoint = vm->instructions;
     return 0;
 }
 
-// execute CALL operation
-int exec_call(VM *vm, uint16_t address) {
-    if (vm->cpu.sp - 2  < STACK_END) {
-        fprintf(stderr, "Stack overflow!\n");
-        return -1;
+// save CPU and pages written since previous checkpoint
+void take_checkpoint(VM *vm) {
+    vm->next_checkpoint = vm->instructions + vm->checkpoint_interval;
+
+    if (vm->checkpoint_count == 0) {
+        // oldest checkpoint keeps whole memory as base image
+        memcpy(vm->checkpoint_base, vm->memory, MEMORY_SIZE);
+    } else if (vm->checkpoint_count == CHECKPOINT_COUNT) {
+        // ring is full: drop oldest, fold next one into base image
+        free(get_checkpoint(vm, 0)->pages);
+        vm->checkpoint_first = (vm->checkpoint_first + 1) % CHECKPOINT_COUNT;
+        vm->checkpoint_count--;
+
+        Checkpoint *oldest = get_checkpoint(vm, 0);
+        apply_checkpoint_pages(vm->checkpoint_base, oldest);
+        free(oldest->pages);
+        oldest->pages = NULL;
+        oldest->page_count = 0;
     }
-    vm->memory[vm->cpu.sp] = vm->cpu.pc & LOW_BYTE_MASK;
-    vm->memory[vm->cpu.sp + 1] = (vm->cpu.pc & HIGH_BYTE_MASK) >> 8;
-    vm->cpu.sp -= 2;
-    vm->cpu.pc = address;
-    return 0;
+
+    Checkpoint *checkpoint = get_checkpoint(vm, vm->checkpoint_count);
+    checkpoint->cpu = vm->cpu;
+    checkpoint->instructions = vm->instructions;
+    checkpoint->counters = vm->counters;
+    checkpoint->allocator = vm->allocator;
+    checkpoint->input_position = vm->input_position;
+    checkpoint->page_count = 0;
+    checkpoint->pages = NULL;
+
+    if (vm->checkpoint_count > 0) {
+        for (int page = 0; page < PAGE_COUNT; page++) {
+            if (vm->dirty_pages[page]) {
+                checkpoint->page_numbers[checkpoint->page_count++] = page;
+            }
+        }
+        if (checkpoint->page_count) {
+            checkpoint->pages = malloc(checkpoint->page_count * PAGE_SIZE);
+            if (!checkpoint->pages) {
+                // can't store delta, keep older checkpoints only
+                fprintf(stderr, "Out of memory for checkpoint!\n");
+                return;
+            }
+            for (uint16_t i = 0; i < checkpoint->page_count; i++) {
+                memcpy(checkpoint->pages + i * PAGE_SIZE, vm->memory + checkpoint->page_numbers[i] * PAGE_SIZE, PAGE_SIZE);
+            }
+        }
+    }
+    vm->checkpoint_count++;
+    memset(vm->dirty_pages, 0, sizeof(vm->dirty_pages));
 }
 
-// execute RET operation
-int exec_ret(VM *vm) {
-    if (vm->cpu.sp > MEMORY_SIZE - 2) {
-        fprintf(stderr, "Stack underflow!\n");
+// restore VM to newest checkpoint not after target instruction count, drops later checkpoints
+int restore_checkpoint(VM *vm, uint64_t target) {
+    if (vm->checkpoint_count == 0 || get_checkpoint(vm, 0)->instructions > target) {
+        fprintf(stderr, "No checkpoint before instruction %llu!\n", (unsigned long long)target);
         return -1;
     }
-    vm->cpu.sp += 2;
-    vm->cpu.pc = vm->memory[vm->cpu.sp] | (vm->memory[vm->cpu.sp + 1] << 8) ;
+    size_t index = 0;
+    while (index + 1 < vm->checkpoint_count && get_checkpoint(vm, index + 1)->instructions <= target) {
+        index++;
+    }
+
+    // program space is never written by program, only restore heap, I/O and stack
+    memcpy(vm->memory + HEAP_ADDRESS, vm->checkpoint_base + HEAP_ADDRESS, MEMORY_SIZE - HEAP_ADDRESS);
+    for (size_t i = 1; i <= index; i++) {
+        apply_checkpoint_pages(vm->memory, get_checkpoint(vm, i));
+    }
+
+    Checkpoint *checkpoint = get_checkpoint(vm, index);
+    if (vm->instructions > vm->replay_end) {
+        vm->replay_end = vm->instructions;
+    }
+    vm->cpu = checkpoint->cpu;
+    vm->instructions = checkpoint->instructions;
+    vm->counters = checkpoint->counters;
+    vm->allocator = checkpoint->allocator;
+    vm->input_position = checkpoint->input_position;
+
+    for (size_t i = index + 1; i < vm->checkpoint_count; i++) {
+        Checkpoint *later = get_checkpoint(vm, i);
+        free(later->pages);
+        later->pages = NULL;
+    }
+    vm->checkpoint_count = index + 1;
+    vm->next_checkpoint = vm->instructions + vm->checkpoint_interval;
+    memset(vm->dirty_pages, 0, sizeof(vm->dirty_pages));
     return 0;
 }
 
-// fetch-decode-execute loop
-void run_vm(VM *vm) {
+// fetch-decode-execute loop, runs until stop, or a single instruction if single is set
+// timing and single are compile-time constants in each engine instance, so timing code
+// is removed entirely from the plain engine and the loop only checks for stops
+static ALWAYS_INLINE VMStatus run_engine(VM *vm, const int timing, const int single) {
+    uint16_t start_pc;
+    uint16_t next_pc; // address after decoded instruction, for timing model
+    uint8_t opcode;
+    int status; // set by exec functions, 1 - watchpoint hit, -1 - fault
+    int32_t mem_address; // data memory address accessed, for timing model
+
     for (;;) {
+        if (vm->instructions == vm->next_checkpoint) {
+            take_checkpoint(vm);
+        }
+        start_pc = vm->cpu.pc;
+        vm->instructions++;
+
         // read opcode
-        uint8_t opcode = vm->memory[vm->cpu.pc++];
+        opcode = vm->memory[vm->cpu.pc++];
 
         // init variables
         uint8_t reg_byte; uint8_t reg1 = 0, reg2 = 0; uint16_t value = 0;
         uint16_t result; 
+        status = 0;
+        mem_address = -1;
 
         // get data on opcode encoding
         OpcodeData opcode_data = opcode_table[opcode];
@@ -470,19 +1867,38 @@ void run_vm(VM *vm) {
                 reg2 = (reg_byte & REG2);
                 break;
             case FORMAT_IMM:
-                value = vm->memory[vm->cpu.pc++] | (vm->memory[vm->cpu.pc++] << 8);
+                value = vm->memory[vm->cpu.pc] | (vm->memory[vm->cpu.pc + 1] << 8);
+                vm->cpu.pc += 2;
                 break;
             case FORMAT_REG_IMM:
                 reg_byte = vm->memory[vm->cpu.pc++];
                 reg1 = (reg_byte & REG1) >> 4;
-                value = vm->memory[vm->cpu.pc++] | (vm->memory[vm->cpu.pc++] << 8);
+                value = vm->memory[vm->cpu.pc] | (vm->memory[vm->cpu.pc + 1] << 8);
+                vm->cpu.pc += 2;
+                break;
+            case FORMAT_REG_DISP8:
+                reg_byte = vm->memory[vm->cpu.pc++];
+                reg1 = (reg_byte & REG1) >> 4;
+                value = (uint16_t)(int8_t)vm->memory[vm->cpu.pc++]; // sign-extend
+                break;
+            case FORMAT_REG_REG_IMM:
+                reg_byte = vm->memory[vm->cpu.pc++];
+                reg1 = (reg_byte & REG1) >> 4;
+                reg2 = (reg_byte & REG2);
+                value = vm->memory[vm->cpu.pc] | (vm->memory[vm->cpu.pc + 1] << 8);
+                vm->cpu.pc += 2;
+                break;
+            case FORMAT_DISP8:
+                value = (int8_t)vm->memory[vm->cpu.pc++]; // sign-extend
+                value += vm->cpu.pc;
                 break;
         }
+        next_pc = vm->cpu.pc;
 
         if (vm->debug) {
             fprintf(stderr, "opcode: 0x%02X; reg1: %d; reg2: %d; value: %d\n", opcode, reg1, reg2, value);
         }
-        
+    
         // execute instruction
         switch (opcode) {
             // Control flow
@@ -495,7 +1911,7 @@ void run_vm(VM *vm) {
                 if (vm->debug) {
                     fprintf(stderr, "HLT.\n");
                 }
-                return;
+                return VM_HALTED;
             case OPCODE_CMPR: 
                 if (vm->debug) {
                     fprintf(stderr, "CMP reg %d reg %d\n", reg1, reg2);
@@ -509,12 +1925,15 @@ void run_vm(VM *vm) {
                 cpu_sub(&vm->cpu, vm->cpu.registers[reg1], value);
                 break;
             case OPCODE_JMP: 
+            case OPCODE_JMPS: 
                 if (vm->debug) {
                     fprintf(stderr, "JMP adr %X\n", value);
                 }
                 vm->cpu.pc = value;
+                vm->counters.branches++;
                 break;
             case OPCODE_JZ: 
+            case OPCODE_JZS: 
                 if (vm->debug) {
                     fprintf(stderr, "JZ adr %X\n", value);
                 }
@@ -523,9 +1942,11 @@ void run_vm(VM *vm) {
                         fprintf(stderr, "jumped\n");
                     }
                     vm->cpu.pc = value;
+                    vm->counters.branches++;
                 }
                 break;
             case OPCODE_JNZ: 
+            case OPCODE_JNZS: 
                 if (vm->debug) {
                     fprintf(stderr, "JNZ adr %X\n", value);
                 }
@@ -534,9 +1955,11 @@ void run_vm(VM *vm) {
                         fprintf(stderr, "jumped\n");
                     }
                     vm->cpu.pc = value;
+                    vm->counters.branches++;
                 }
                 break;
             case OPCODE_JC: 
+            case OPCODE_JCS: 
                 if (vm->debug) {
                     fprintf(stderr, "JC adr %X\n", value);
                 }
@@ -545,9 +1968,11 @@ void run_vm(VM *vm) {
                         fprintf(stderr, "jumped\n");
                     }
                     vm->cpu.pc = value;
+                    vm->counters.branches++;
                 }
                 break;
             case OPCODE_JS: 
+            case OPCODE_JSS: 
                 if (vm->debug) {
                     fprintf(stderr, "JC adr %X\n", value);
                 }
@@ -556,19 +1981,29 @@ void run_vm(VM *vm) {
                         fprintf(stderr, "jumped\n");
                     }
                     vm->cpu.pc = value;
+                    vm->counters.branches++;
                 }
                 break;
             case OPCODE_CALL: 
+            case OPCODE_CALLS: 
                 if (vm->debug) {
                     fprintf(stderr, "CALL adr %X\n", value);
                 }
-                exec_call(vm, value);
+                mem_address = vm->cpu.sp;
+                status = exec_call(vm, value);
                 break;
             case OPCODE_RET: 
                 if (vm->debug) {
                     fprintf(stderr, "RET\n");
                 }
-                exec_ret(vm);
+                mem_address = (uint16_t)(vm->cpu.sp + 2);
+                status = exec_ret(vm);
+                break;
+            case OPCODE_SYS: 
+                if (vm->debug) {
+                    fprintf(stderr, "SYS %d\n", value);
+                }
+                status = exec_sys(vm, value);
                 break;
 
             // Memory
@@ -588,73 +2023,85 @@ void run_vm(VM *vm) {
                 if (vm->debug) {
                     fprintf(stderr, "STOR adr %X <- reg %d\n", value, reg1);
                 }
-                exec_stor(vm, value, vm->cpu.registers[reg1]);
+                mem_address = value;
+                status = exec_stor(vm, value, vm->cpu.registers[reg1]);
                 break;
             case OPCODE_STORMI: 
                 if (vm->debug) {
                     fprintf(stderr, "STOR ind %d <- imm %d\n", reg1, value);
                 }
-                exec_stor(vm, vm->cpu.registers[reg1], value);
+                mem_address = vm->cpu.registers[reg1];
+                status = exec_stor(vm, vm->cpu.registers[reg1], value);
                 break;
             case OPCODE_STORMR: 
                 if (vm->debug) {
                     fprintf(stderr, "STOR reg %d -> ind %d\n", reg1, reg2);
                 }
-                exec_stor(vm, vm->cpu.registers[reg2], vm->cpu.registers[reg1]);
+                mem_address = vm->cpu.registers[reg2];
+                status = exec_stor(vm, vm->cpu.registers[reg2], vm->cpu.registers[reg1]);
                 break;
             case OPCODE_LOADRD: 
                 if (vm->debug) {
                     fprintf(stderr, "LOAD reg %d <- adr %X\n", value, reg1);
                 }
-                exec_load(vm, reg1, value);
+                mem_address = value;
+                status = exec_load(vm, reg1, value);
                 break;
             case OPCODE_LOADRM: 
                 if (vm->debug) {
                     fprintf(stderr, "LOAD reg %d <- ind %d\n", reg1, reg2);
                 }
-                exec_load(vm, reg1, vm->cpu.registers[reg2]);
+                mem_address = vm->cpu.registers[reg2];
+                status = exec_load(vm, reg1, vm->cpu.registers[reg2]);
                 break;
             case OPCODE_PUSH: 
                 if (vm->debug) {
                     fprintf(stderr, "PUSH reg %d\n", reg1);
                 }
-                exec_push(vm, vm->cpu.registers[reg1]);
+                mem_address = vm->cpu.sp;
+                status = exec_push(vm, vm->cpu.registers[reg1]);
                 break;
             case OPCODE_POP: 
                 if (vm->debug) {
                     fprintf(stderr, "POP to reg %d\n", reg1);
                 }
-                exec_pop(vm, reg1);
+                mem_address = (uint16_t)(vm->cpu.sp + 2);
+                status = exec_pop(vm, reg1);
                 break;
             case OPCODE_STORBDR: 
                 if (vm->debug) {
                     fprintf(stderr, "STORB adr %X <- reg %d\n", value, reg1);
                 }
-                exec_storb(vm, value, vm->cpu.registers[reg1]);
+                mem_address = value;
+                status = exec_storb(vm, value, vm->cpu.registers[reg1]);
                 break;
             case OPCODE_STORBMI: 
                 if (vm->debug) {
                     fprintf(stderr, "STORB imm %d -> ind %d\n", reg1, value);
                 }
-                exec_storb(vm, vm->cpu.registers[reg1], value);
+                mem_address = vm->cpu.registers[reg1];
+                status = exec_storb(vm, vm->cpu.registers[reg1], value);
                 break;
             case OPCODE_STORBMR: 
                 if (vm->debug) {
                     fprintf(stderr, "STORB reg %d -> ind %d\n", reg1, reg2);
                 }
-                exec_storb(vm, vm->cpu.registers[reg2], vm->cpu.registers[reg1]);
+                mem_address = vm->cpu.registers[reg2];
+                status = exec_storb(vm, vm->cpu.registers[reg2], vm->cpu.registers[reg1]);
                 break;
             case OPCODE_LOADBRD: 
                 if (vm->debug) {
                     fprintf(stderr, "LOADB reg %d <- adr %X\n", reg1, value);
                 }
-                exec_loadb(vm, reg1, value);
+                mem_address = value;
+                status = exec_loadb(vm, reg1, value);
                 break;
             case OPCODE_LOADBRM: 
                 if (vm->debug) {
                     fprintf(stderr, "LOADB reg %d <- ind %d\n", reg1, reg2);
                 }
-                exec_loadb(vm, reg1, vm->cpu.registers[reg2]);
+                mem_address = vm->cpu.registers[reg2];
+                status = exec_loadb(vm, reg1, vm->cpu.registers[reg2]);
                 break;
 
             // Arithmetics
@@ -718,16 +2165,54 @@ void run_vm(VM *vm) {
                 if (vm->debug) {
                     fprintf(stderr, "DIV reg %d <- reg %d\n", reg1, reg2);
                 }
-                result = cpu_div(&vm->cpu, vm->cpu.registers[reg1], vm->cpu.registers[reg2]);
-                vm->cpu.registers[reg1] = result;
+                status = exec_div(vm, reg1, vm->cpu.registers[reg2]);
                 break;
             case OPCODE_DIVI: 
                 if (vm->debug) {
                     fprintf(stderr, "DIV reg %d <- imm %d\n", reg1, value);
                 }
-                result = cpu_div(&vm->cpu, vm->cpu.registers[reg1], value);
+                status = exec_div(vm, reg1, value);
+                break;
+            case OPCODE_ADCR: 
+                if (vm->debug) {
+                    fprintf(stderr, "ADC reg %d <- reg %d\n", reg1, reg2);
+                }
+                result = cpu_adc(&vm->cpu, vm->cpu.registers[reg1], vm->cpu.registers[reg2]);
+                vm->cpu.registers[reg1] = result;
+                break;
+            case OPCODE_ADCI: 
+                if (vm->debug) {
+                    fprintf(stderr, "ADC reg %d <- imm %d\n", reg1, value);
+                }
+                result = cpu_adc(&vm->cpu, vm->cpu.registers[reg1], value);
+                vm->cpu.registers[reg1] = result;
+                break;
+            case OPCODE_SBCR: 
+                if (vm->debug) {
+                    fprintf(stderr, "SBC reg %d <- reg %d\n", reg1, reg2);
+                }
+                result = cpu_sbc(&vm->cpu, vm->cpu.registers[reg1], vm->cpu.registers[reg2]);
+                vm->cpu.registers[reg1] = result;
+                break;
+            case OPCODE_SBCI: 
+                if (vm->debug) {
+                    fprintf(stderr, "SBC reg %d <- imm %d\n", reg1, value);
+                }
+                result = cpu_sbc(&vm->cpu, vm->cpu.registers[reg1], value);
                 vm->cpu.registers[reg1] = result;
                 break;
+            case OPCODE_MULWR: 
+                if (vm->debug) {
+                    fprintf(stderr, "MULW reg %d:%d <- reg %d * reg %d\n", reg2, reg1, reg1, reg2);
+                }
+                status = exec_mulw(vm, reg1, reg2);
+                break;
+            case OPCODE_DIVMODR: 
+                if (vm->debug) {
+                    fprintf(stderr, "DIVMOD reg %d, reg %d\n", reg1, reg2);
+                }
+                status = exec_divmod(vm, reg1, reg2);
+                break;
 
             // Bit ops
             case OPCODE_ANDR:
@@ -834,37 +2319,573 @@ void run_vm(VM *vm) {
                 }
                 vm->cpu.bp = vm->cpu.bp - value;
                 break;
+            case OPCODE_ENTER: 
+                if (vm->debug) {
+                    fprintf(stderr, "ENTER imm %d\n", value);
+                }
+                mem_address = vm->cpu.sp;
+                status = exec_enter(vm, value);
+                break;
+            case OPCODE_LEAVE: 
+                if (vm->debug) {
+                    fprintf(stderr, "LEAVE\n");
+                }
+                mem_address = (uint16_t)(vm->cpu.bp + 2);
+                status = exec_leave(vm);
+                break;
+            case OPCODE_LOADRF: 
+                if (vm->debug) {
+                    fprintf(stderr, "LOAD reg %d <- BP%+d\n", reg1, (int16_t)value);
+                }
+                mem_address = (uint16_t)(vm->cpu.bp + value);
+                status = exec_load(vm, reg1, vm->cpu.bp + value);
+                break;
+            case OPCODE_STORFR: 
+                if (vm->debug) {
+                    fprintf(stderr, "STOR reg %d -> BP%+d\n", reg1, (int16_t)value);
+                }
+                mem_address = (uint16_t)(vm->cpu.bp + value);
+                status = exec_stor_frame(vm, vm->cpu.bp + value, vm->cpu.registers[reg1], 2);
+                break;
+            case OPCODE_LOADBRF: 
+                if (vm->debug) {
+                    fprintf(stderr, "LOADB reg %d <- BP%+d\n", reg1, (int16_t)value);
+                }
+                mem_address = (uint16_t)(vm->cpu.bp + value);
+                status = exec_loadb(vm, reg1, vm->cpu.bp + value);
+                break;
+            case OPCODE_STORBFR: 
+                if (vm->debug) {
+                    fprintf(stderr, "STORB reg %d -> BP%+d\n", reg1, (int16_t)value);
+                }
+                mem_address = (uint16_t)(vm->cpu.bp + value);
+                status = exec_stor_frame(vm, vm->cpu.bp + value, vm->cpu.registers[reg1], 1);
+                break;
+            // Memory, extended addressing
+            case OPCODE_LOADRX: 
+                if (vm->debug) {
+                    fprintf(stderr, "LOAD reg %d <- ind %d + %d\n", reg1, reg2, value);
+                }
+                mem_address = (uint16_t)(vm->cpu.registers[reg2] + value);
+                status = exec_load(vm, reg1, vm->cpu.registers[reg2] + value);
+                break;
+            case OPCODE_STORXR: 
+                if (vm->debug) {
+                    fprintf(stderr, "STOR reg %d -> ind %d + %d\n", reg1, reg2, value);
+                }
+                mem_address = (uint16_t)(vm->cpu.registers[reg2] + value);
+                status = exec_stor(vm, vm->cpu.registers[reg2] + value, vm->cpu.registers[reg1]);
+                break;
+            case OPCODE_LOADBRX: 
+                if (vm->debug) {
+                    fprintf(stderr, "LOADB reg %d <- ind %d + %d\n", reg1, reg2, value);
+                }
+                mem_address = (uint16_t)(vm->cpu.registers[reg2] + value);
+                status = exec_loadb(vm, reg1, vm->cpu.registers[reg2] + value);
+                break;
+            case OPCODE_STORBXR: 
+                if (vm->debug) {
+                    fprintf(stderr, "STORB reg %d -> ind %d + %d\n", reg1, reg2, value);
+                }
+                mem_address = (uint16_t)(vm->cpu.registers[reg2] + value);
+                status = exec_storb(vm, vm->cpu.registers[reg2] + value, vm->cpu.registers[reg1]);
+                break;
+            // post-increment and pre-decrement: loads update pointer before writing
+            // destination, stores update it only if store succeeded
+            case OPCODE_LOADRPI: 
+                if (vm->debug) {
+                    fprintf(stderr, "LOAD reg %d <- ind %d, post-increment\n", reg1, reg2);
+                }
+                mem_address = vm->cpu.registers[reg2];
+                vm->cpu.registers[reg2] += 2;
+                status = exec_load(vm, reg1, mem_address);
+                break;
+            case OPCODE_STORPIR: 
+                if (vm->debug) {
+                    fprintf(stderr, "STOR reg %d -> ind %d, post-increment\n", reg1, reg2);
+                }
+                mem_address = vm->cpu.registers[reg2];
+                status = exec_stor(vm, mem_address, vm->cpu.registers[reg1]);
+                if (status >= 0) {
+                    vm->cpu.registers[reg2] += 2;
+                }
+                break;
+            case OPCODE_LOADBRPI: 
+                if (vm->debug) {
+                    fprintf(stderr, "LOADB reg %d <- ind %d, post-increment\n", reg1, reg2);
+                }
+                mem_address = vm->cpu.registers[reg2];
+                vm->cpu.registers[reg2] += 1;
+                status = exec_loadb(vm, reg1, mem_address);
+                break;
+            case OPCODE_STORBPIR: 
+                if (vm->debug) {
+                    fprintf(stderr, "STORB reg %d -> ind %d, post-increment\n", reg1, reg2);
+                }
+                mem_address = vm->cpu.registers[reg2];
+                status = exec_storb(vm, mem_address, vm->cpu.registers[reg1]);
+                if (status >= 0) {
+                    vm->cpu.registers[reg2] += 1;
+                }
+                break;
+            case OPCODE_LOADRPD: 
+                if (vm->debug) {
+                    fprintf(stderr, "LOAD reg %d <- ind %d, pre-decrement\n", reg1, reg2);
+                }
+                mem_address = (uint16_t)(vm->cpu.registers[reg2] - 2);
+                vm->cpu.registers[reg2] -= 2;
+                status = exec_load(vm, reg1, mem_address);
+                break;
+            case OPCODE_STORPDR: 
+                if (vm->debug) {
+                    fprintf(stderr, "STOR reg %d -> ind %d, pre-decrement\n", reg1, reg2);
+                }
+                mem_address = (uint16_t)(vm->cpu.registers[reg2] - 2);
+                status = exec_stor(vm, mem_address, vm->cpu.registers[reg1]);
+                if (status >= 0) {
+                    vm->cpu.registers[reg2] -= 2;
+                }
+                break;
+            case OPCODE_LOADBRPD: 
+                if (vm->debug) {
+                    fprintf(stderr, "LOADB reg %d <- ind %d, pre-decrement\n", reg1, reg2);
+                }
+                mem_address = (uint16_t)(vm->cpu.registers[reg2] - 1);
+                vm->cpu.registers[reg2] -= 1;
+                status = exec_loadb(vm, reg1, mem_address);
+                break;
+            case OPCODE_STORBPDR: 
+                if (vm->debug) {
+                    fprintf(stderr, "STORB reg %d -> ind %d, pre-decrement\n", reg1, reg2);
+                }
+                mem_address = (uint16_t)(vm->cpu.registers[reg2] - 1);
+                status = exec_storb(vm, mem_address, vm->cpu.registers[reg1]);
+                if (status >= 0) {
+                    vm->cpu.registers[reg2] -= 1;
+                }
+                break;
+
+            // Heap allocator
+            case OPCODE_ALLOCR: 
+                if (vm->debug) {
+                    fprintf(stderr, "ALLOC reg %d <- reg %d bytes\n", reg1, reg2);
+                }
+                status = exec_alloc(vm, reg1, vm->cpu.registers[reg2]);
+                break;
+            case OPCODE_ALLOCI: 
+                if (vm->debug) {
+                    fprintf(stderr, "ALLOC reg %d <- %d bytes\n", reg1, value);
+                }
+                status = exec_alloc(vm, reg1, value);
+                break;
+            case OPCODE_FREE: 
+                if (vm->debug) {
+                    fprintf(stderr, "FREE reg %d\n", reg1);
+                }
+                status = exec_free(vm, vm->cpu.registers[reg1]);
+                break;
+
+            // Debugger
+            case OPCODE_BRK:
+                if (find_breakpoint(vm, start_pc) >= 0) {
+                    vm->cpu.pc = start_pc;
+                    vm->instructions--;
+                    return VM_BREAKPOINT;
+                }
+                fprintf(stderr, "UNKNOWN OPCODE: %X! Halting.\n", opcode);
+                status = -1;
+                break;
 
             default:
                 fprintf(stderr, "UNKNOWN OPCODE: %X! Halting.\n", opcode);
-                return;
+                status = -1;
+                break;
 
         }
-        if (vm->cpu.pc >= HEAP_ADDRESS) {
-            fprintf(stderr, "PC is outside program space! Halting.\n");
-            return;
+        // stops are rare, handled after the loop
+        if (status != 0 || single || vm->cpu.pc >= HEAP_ADDRESS) {
+            break;
+        }
+        if (timing) {
+            account_timing(&vm->timing, opcode, start_pc, mem_address, vm->cpu.pc != next_pc);
         }
-        // dump_cpu(&vm->cpu);
         if (vm->debug) {
             dump_vm(vm);
         }
-        
+    }
+    if (status < 0) {
+        // faulting instruction has no effect, stop before it
+        vm->cpu.pc = start_pc;
+        vm->instructions--;
+        return VM_FAULT;
+    }
+    if (vm->cpu.pc >= HEAP_ADDRESS) {
+        fprintf(stderr, "PC is outside program space! Halting.\n");
+        return VM_FAULT;
+    }
+    if (timing) {
+        account_timing(&vm->timing, opcode, start_pc, mem_address, vm->cpu.pc != next_pc);
+    }
+    if (vm->debug) {
+        dump_vm(vm);
+    }
+    if (status > 0) {
+        return VM_WATCHPOINT;
+    }
+    return VM_RUNNING;
+}
+
+// plain engine, single instruction
+VMStatus step_plain(VM *vm) {
+    return run_engine(vm, 0, 1);
+}
+
+// engine with timing model, single instruction
+VMStatus step_timed(VM *vm) {
+    return run_engine(vm, 1, 1);
+}
+
+// execute single instruction
+VMStatus step_vm(VM *vm) {
+    return vm->timing.enabled ? step_timed(vm) : step_plain(vm);
+}
+
+// fetch-decode-execute loop, runs until halt or debugger stop
+VMStatus run_vm(VM *vm) {
+    if (vm->timing.enabled) {
+        return run_engine(vm, 1, 0);
+    }
+    return run_engine(vm, 0, 0);
+}
+
+// execute single instruction, stepping over a breakpoint trap at PC
+VMStatus step_over_breakpoint(VM *vm) {
+    uint16_t address = vm->cpu.pc;
+    int i = find_breakpoint(vm, address);
+    if (i < 0) {
+        return step_vm(vm);
+    }
+    vm->memory[address] = vm->breakpoints[i].original;
+    VMStatus status = step_vm(vm);
+    vm->memory[address] = OPCODE_BRK;
+    return status;
+}
+
+// resume execution from debugger until next stop
+VMStatus continue_vm(VM *vm) {
+    VMStatus status = step_over_breakpoint(vm);
+    if (status != VM_RUNNING) {
+        return status;
+    }
+    return run_vm(vm);
+}
+
+// re-execute until instruction count reaches target, ignoring breakpoints
+// last_stop (optional) receives count of the last breakpoint or watchpoint stop before target
+VMStatus replay_vm(VM *vm, uint64_t target, uint64_t *last_stop) {
+    VMStatus status = VM_RUNNING;
+    while (vm->instructions < target && (status == VM_RUNNING || status == VM_WATCHPOINT)) {
+        if (last_stop && find_breakpoint(vm, vm->cpu.pc) >= 0) {
+            *last_stop = vm->instructions;
+        }
+        status = step_over_breakpoint(vm);
+        if (last_stop && status == VM_WATCHPOINT && vm->instructions < target) {
+            *last_stop = vm->instructions;
+        }
+    }
+    return status == VM_WATCHPOINT ? VM_RUNNING : status;
+}
+
+// go back count instructions: restore nearest checkpoint and re-execute
+VMStatus reverse_step_vm(VM *vm, VMStatus status, uint64_t count) {
+    if (vm->checkpoint_count == 0) {
+        fprintf(stderr, "No checkpoints yet!\n");
+        return status;
+    }
+    uint64_t oldest = get_checkpoint(vm, 0)->instructions;
+    uint64_t target = count < vm->instructions ? vm->instructions - count : 0;
+    if (target < oldest) {
+        fprintf(stderr, "Reached oldest checkpoint.\n");
+        target = oldest;
+    }
+    restore_checkpoint(vm, target);
+    return replay_vm(vm, target, NULL);
+}
+
+// go back to previous breakpoint or watchpoint stop, or to oldest checkpoint
+VMStatus reverse_continue_vm(VM *vm, VMStatus status) {
+    if (vm->checkpoint_count == 0) {
+        fprintf(stderr, "No checkpoints yet!\n");
+        return status;
+    }
+    uint64_t current = vm->instructions;
+    restore_checkpoint(vm, get_checkpoint(vm, 0)->instructions);
+
+    // find last stop by re-executing history, then go there
+    uint64_t last_stop = vm->instructions;
+    replay_vm(vm, current, &last_stop);
+    restore_checkpoint(vm, last_stop);
+    replay_vm(vm, last_stop, NULL);
+    if (find_breakpoint(vm, vm->cpu.pc) >= 0) {
+        return VM_BREAKPOINT;
+    }
+    return VM_RUNNING;
+}
+
+// parse debugger location: number, label or label+offset
+int parse_location(VM *vm, const char *string, uint16_t *address) {
+    char name[SYMBOL_NAME_LENGTH];
+    char *end;
+    long offset = 0;
+
+    long number = strtol(string, &end, 0);
+    if (end != string && *end == '\0') {
+        *address = number;
+        return 0;
+    }
+
+    size_t length = strcspn(string, "+-");
+    if (length == 0 || length >= SYMBOL_NAME_LENGTH) {
+        fprintf(stderr, "Invalid location: %s\n", string);
+        return -1;
+    }
+    memcpy(name, string, length);
+    name[length] = '\0';
+    if (string[length] != '\0') {
+        offset = strtol(string + length, &end, 0);
+        if (*end != '\0') {
+            fprintf(stderr, "Invalid location: %s\n", string);
+            return -1;
+        }
+    }
+
+    Symbol *symbol = find_symbol(vm, name);
+    if (!symbol) {
+        fprintf(stderr, "Unknown symbol: %s\n", name);
+        return -1;
+    }
+    *address = symbol->address + offset;
+    return 0;
+}
+
+// report why execution stopped
+void report_stop(VM *vm, VMStatus status) {
+    switch (status) {
+        case VM_RUNNING:
+            fprintf(stderr, "Stopped at ");
+            break;
+        case VM_HALTED:
+            fprintf(stderr, "Halted at ");
+            break;
+        case VM_BREAKPOINT:
+            fprintf(stderr, "Breakpoint at ");
+            break;
+        case VM_WATCHPOINT:
+            fprintf(stderr, "Watchpoint ");
+            print_address(stderr, vm, vm->watch_hit);
+            fprintf(stderr, " written, now %d, at ", vm->memory[vm->watch_hit]);
+            break;
+        case VM_FAULT:
+            fprintf(stderr, "Fault at ");
+            break;
+    }
+    print_address(stderr, vm, vm->cpu.pc);
+    fprintf(stderr, " (instruction %llu)\n", (unsigned long long)vm->instructions);
+}
+
+// dump memory range as hex bytes, 16 per row
+void dump_memory(VM *vm, uint16_t address, uint16_t count) {
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t current = address + i;
+        if (i % 16 == 0) {
+            if (i) fprintf(stderr, "\n");
+            print_address(stderr, vm, current);
+            fprintf(stderr, ":");
+        }
+        fprintf(stderr, " %02X", vm->memory[current]);
+    }
+    fprintf(stderr, "\n");
+}
+
+// interactive/scriptable debugger console, reads commands from input
+void run_console(VM *vm, FILE *input) {
+    char line[CONSOLE_LINE_LENGTH];
+    VMStatus status = VM_RUNNING;
+    uint16_t address;
+
+    report_stop(vm, status);
+    for (;;) {
+        fprintf(stderr, "(akvm) ");
+        if (!fgets(line, sizeof(line), input)) {
+            // end of script: run until program finishes
+            if (status == VM_HALTED || status == VM_FAULT) {
+                return;
+            }
+            strcpy(line, "continue");
+        }
+
+        char command[CONSOLE_LINE_LENGTH] = "";
+        char arg1[CONSOLE_LINE_LENGTH] = "";
+        char arg2[CONSOLE_LINE_LENGTH] = "";
+        if (sscanf(line, "%127s %127s %127s", command, arg1, arg2) < 1) {
+            continue;
+        }
+
+        if (strcmp(command, "c") == 0 || strcmp(command, "continue") == 0) {
+            if (status == VM_HALTED || status == VM_FAULT) {
+                fprintf(stderr, "Program is not running.\n");
+                continue;
+            }
+            status = continue_vm(vm);
+            report_stop(vm, status);
+        }
+        else if (strcmp(command, "s") == 0 || strcmp(command, "step") == 0) {
+            if (status == VM_HALTED || status == VM_FAULT) {
+                fprintf(stderr, "Program is not running.\n");
+                continue;
+            }
+            long steps = arg1[0] ? strtol(arg1, NULL, 0) : 1;
+            status = VM_RUNNING;
+            for (long i = 0; i < steps && status == VM_RUNNING; i++) {
+                status = step_over_breakpoint(vm);
+            }
+            report_stop(vm, status);
+        }
+        else if (strcmp(command, "rs") == 0 || strcmp(command, "reverse-step") == 0) {
+            if (!vm->checkpoint_interval) {
+                fprintf(stderr, "Checkpoints are disabled (use -k).\n");
+                continue;
+            }
+            status = reverse_step_vm(vm, status, arg1[0] ? strtoull(arg1, NULL, 0) : 1);
+            report_stop(vm, status);
+        }
+        else if (strcmp(command, "rc") == 0 || strcmp(command, "reverse-continue") == 0) {
+            if (!vm->checkpoint_interval) {
+                fprintf(stderr, "Checkpoints are disabled (use -k).\n");
+                continue;
+            }
+            status = reverse_continue_vm(vm, status);
+            report_stop(vm, status);
+        }
+        else if (strcmp(command, "b") == 0 || strcmp(command, "break") == 0) {
+            if (parse_location(vm, arg1, &address) == 0 && add_breakpoint(vm, address) == 0) {
+                fprintf(stderr, "Breakpoint set at ");
+                print_address(stderr, vm, address);
+                fprintf(stderr, "\n");
+            }
+        }
+        else if (strcmp(command, "d") == 0 || strcmp(command, "delete") == 0) {
+            if (parse_location(vm, arg1, &address) == 0) {
+                remove_breakpoint(vm, address);
+            }
+        }
+        else if (strcmp(command, "w") == 0 || strcmp(command, "watch") == 0) {
+            if (parse_location(vm, arg1, &address) == 0 && add_watchpoint(vm, address) == 0) {
+                fprintf(stderr, "Watchpoint set at ");
+                print_address(stderr, vm, address);
+                fprintf(stderr, "\n");
+            }
+        }
+        else if (strcmp(command, "unwatch") == 0) {
+            if (parse_location(vm, arg1, &address) == 0) {
+                remove_watchpoint(vm, address);
+            }
+        }
+        else if (strcmp(command, "r") == 0 || strcmp(command, "regs") == 0) {
+            dump_cpu(&vm->cpu);
+        }
+        else if (strcmp(command, "x") == 0 || strcmp(command, "mem") == 0) {
+            if (parse_location(vm, arg1, &address) == 0) {
+                dump_memory(vm, address, arg2[0] ? strtol(arg2, NULL, 0) : 16);
+            }
+        }
+        else if (strcmp(command, "i") == 0 || strcmp(command, "info") == 0) {
+            for (uint8_t i = 0; i < vm->breakpoint_count; i++) {
+                fprintf(stderr, "break ");
+                print_address(stderr, vm, vm->breakpoints[i].address);
+                fprintf(stderr, "\n");
+            }
+            for (uint8_t i = 0; i < vm->watchpoint_count; i++) {
+                fprintf(stderr, "watch ");
+                print_address(stderr, vm, vm->watchpoints[i]);
+                fprintf(stderr, "\n");
+            }
+        }
+        else if (strcmp(command, "q") == 0 || strcmp(command, "quit") == 0) {
+            return;
+        }
+        else if (strcmp(command, "h") == 0 || strcmp(command, "help") == 0) {
+            fprintf(stderr,
+                "break|b LOC       set breakpoint\n"
+                "delete|d LOC      remove breakpoint\n"
+                "watch|w LOC       stop on writes to address\n"
+                "unwatch LOC       remove watchpoint\n"
+                "step|s [N]        execute N instructions\n"
+                "continue|c        run until breakpoint, watchpoint or halt\n"
+                "reverse-step|rs [N]  go back N instructions (needs -k)\n"
+                "reverse-continue|rc  go back to previous breakpoint or watchpoint stop\n"
+                "regs|r            show registers\n"
+                "mem|x LOC [N]     show N bytes of memory\n"
+                "info|i            list breakpoints and watchpoints\n"
+                "quit|q            stop program\n"
+                "LOC is a number (42, 0x2A), label or label+offset\n");
+        }
+        else {
+            fprintf(stderr, "Unknown command: %s (try help)\n", command);
+        }
     }
 }
 
 int main(int argc, char *argv[]) {
     int debug = 0;
     int testing = 0;
+    int stats = 0;
+    int timing = 0;
+    unsigned int cache_sets = DEFAULT_CACHE_SETS, cache_ways = DEFAULT_CACHE_WAYS, cache_line = DEFAULT_CACHE_LINE;
+    const char* latency_filename = NULL;
     const char* filename = NULL;
+    const char* symbols_filename = NULL;
+    const char* console_filename = NULL;
+    const char* disk_filename = NULL;
+    unsigned long long checkpoint_interval = 0;
 
     // read command-line arguments
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--debug") == 0) {
             debug = 1;
         } 
+        else if ((strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--symbols") == 0) && i + 1 < argc) {
+            symbols_filename = argv[++i];
+        } 
+        else if ((strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--console") == 0) && i + 1 < argc) {
+            console_filename = argv[++i];
+        } 
+        else if ((strcmp(argv[i], "-k") == 0 || strcmp(argv[i], "--checkpoint") == 0) && i + 1 < argc) {
+            checkpoint_interval = strtoull(argv[++i], NULL, 0);
+        } 
+        else if (strcmp(argv[i], "--disk") == 0 && i + 1 < argc) {
+            disk_filename = argv[++i];
+        } 
         else if (strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--testing") == 0) {
             testing = 1;
         } 
+        else if (strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--perf") == 0) {
+            stats = 1;
+        } 
+        else if (strcmp(argv[i], "-T") == 0 || strcmp(argv[i], "--timing") == 0) {
+            timing = 1;
+        } 
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            timing = 1;
+            if (sscanf(argv[++i], "%u,%u,%u", &cache_sets, &cache_ways, &cache_line) != 3) {
+                fprintf(stderr, "Invalid cache configuration: %s (expected SETS,WAYS,LINE)\n", argv[i]);
+                return 1;
+            }
+        } 
+        else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+            timing = 1;
+            latency_filename = argv[++i];
+        } 
         else if (argv[i][0] == '-') {
             fprintf(stderr, "Unknown option: %s\n", argv[i]);
             return 1;
@@ -874,7 +2895,7 @@ int main(int argc, char *argv[]) {
     }
 
     if (!filename) {
-        fprintf(stderr, "Usage: %s [-d|--debug] [-t|--testing] <binary file>\n", argv[0]);
+        fprintf(stderr, "Usage: %s [-d|--debug] [-t|--testing] [-p|--perf] [-T|--timing] [--cache <sets,ways,line>] [--latency <file>] [-s|--symbols <symbol file>] [-c|--console <command file>] [-k|--checkpoint <interval>] [--disk <image file>] <binary file>\n", argv[0]);
         return 1;
     }
 
@@ -893,18 +2914,59 @@ int main(int argc, char *argv[]) {
     if (load_program(&vm, filename) == -1) {
         return 1;
     }
+    if (symbols_filename && load_symbols(&vm, symbols_filename) == -1) {
+        return 1;
+    }
+    if (checkpoint_interval && init_checkpoints(&vm, checkpoint_interval) == -1) {
+        return 1;
+    }
+    if (timing && init_timing(&vm, cache_sets, cache_ways, cache_line) == -1) {
+        free_vm(&vm);
+        return 1;
+    }
+    if (latency_filename && load_latencies(&vm, latency_filename) == -1) {
+        free_vm(&vm);
+        return 1;
+    }
+    if (disk_filename && attach_disk(&vm, disk_filename) == -1) {
+        free_vm(&vm);
+        return 1;
+    }
        
     if (vm.debug) {
         dump_vm(&vm);
     }
     
-    // run program
-    run_vm(&vm);
+    // run program, under debugger console if requested
+    vm.start_time = host_microseconds();
+    if (console_filename) {
+        FILE *console = fopen(console_filename, "r");
+        if (!console) {
+            perror("Failed to open console");
+            free_vm(&vm);
+            return 1;
+        }
+        run_console(&vm, console);
+        fclose(console);
+    } else {
+        run_vm(&vm);
+    }
        
     if (vm.debug) {
         dump_vm_verbose(&vm);
     }
     
+    if (stats || timing) {
+        fflush(stdout);
+    }
+    if (stats) {
+        print_stats(&vm);
+    }
+    if (timing) {
+        print_timing(&vm);
+    }
+
+    free_vm(&vm);
     if (!testing) printf("\n");
     return 0;
 }
\ No newline at end of file
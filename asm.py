@@ -31,6 +31,35 @@ class OperandMemImm: # [expr]
     def __str__(self):
         return '[' + ' '.join(t[1] for t in self.expr) + ']'
 
+@dataclass
+class OperandMemBP: # [BP+expr], [BP-expr]
+    expr: list # signed offset, e.g. ['-', '4']
+
+    def __str__(self):
+        return '[BP ' + ' '.join(t[1] for t in self.expr) + ']'
+
+@dataclass
+class OperandMemRegDisp: # [Rx+expr], [Rx-expr]
+    reg: int
+    expr: list # signed displacement, e.g. ['+', 'table']
+
+    def __str__(self):
+        return f"[R{self.reg} " + ' '.join(t[1] for t in self.expr) + ']'
+
+@dataclass
+class OperandMemRegInc: # [Rx+]
+    reg: int
+
+    def __str__(self):
+        return f"[R{self.reg}+]"
+
+@dataclass
+class OperandMemRegDec: # [-Rx]
+    reg: int
+
+    def __str__(self):
+        return f"[-R{self.reg}]"
+
 # @dataclass
 # class OperandAddr:
 #     symbol: str
@@ -54,6 +83,11 @@ class EncodingFormat(Enum):
     REG_IMM = auto()
     REG_MEMREG = auto()
     REG_MEMIMM = auto()
+    REG_MEMBP = auto()
+    REG_MEMREGDISP = auto()
+    REG_MEMREGINC = auto()
+    REG_MEMREGDEC = auto()
+    REL8 = auto()
 
 FORMAT_SPECS = {
     EncodingFormat.NONE: EncodingFormatSpec(
@@ -83,6 +117,27 @@ FORMAT_SPECS = {
     EncodingFormat.REG_MEMIMM: EncodingFormatSpec(
         (OperandReg, OperandMemImm),
         4
+    ),
+    EncodingFormat.REG_MEMBP: EncodingFormatSpec(
+        (OperandReg, OperandMemBP),
+        3
+    ),
+    EncodingFormat.REG_MEMREGDISP: EncodingFormatSpec(
+        (OperandReg, OperandMemRegDisp),
+        4
+    ),
+    EncodingFormat.REG_MEMREGINC: EncodingFormatSpec(
+        (OperandReg, OperandMemRegInc),
+        2
+    ),
+    EncodingFormat.REG_MEMREGDEC: EncodingFormatSpec(
+        (OperandReg, OperandMemRegDec),
+        2
+    ),
+    # short branch, never matched directly: branches start as REL8 and are relaxed to IMM
+    EncodingFormat.REL8: EncodingFormatSpec(
+        (OperandImm,),
+        2
     )
 }
 
@@ -118,25 +173,34 @@ pattern_table = {
     },
     'JMP': {
         EncodingFormat.IMM: InstructionSpec(mnemonic='JMP', opcode=0x04, format=EncodingFormat.IMM),
+        EncodingFormat.REL8: InstructionSpec(mnemonic='JMPS', opcode=0x60, format=EncodingFormat.REL8),
     },
     'JZ': {
         EncodingFormat.IMM: InstructionSpec(mnemonic='JZ', opcode=0x05, format=EncodingFormat.IMM),
+        EncodingFormat.REL8: InstructionSpec(mnemonic='JZS', opcode=0x61, format=EncodingFormat.REL8),
     },
     'JNZ': {
         EncodingFormat.IMM: InstructionSpec(mnemonic='JNZ', opcode=0x06, format=EncodingFormat.IMM),
+        EncodingFormat.REL8: InstructionSpec(mnemonic='JNZS', opcode=0x62, format=EncodingFormat.REL8),
     },
     'JC': {
         EncodingFormat.IMM: InstructionSpec(mnemonic='JC', opcode=0x07, format=EncodingFormat.IMM),
+        EncodingFormat.REL8: InstructionSpec(mnemonic='JCS', opcode=0x63, format=EncodingFormat.REL8),
     },
     'JS': {
         EncodingFormat.IMM: InstructionSpec(mnemonic='JS', opcode=0x08, format=EncodingFormat.IMM),
+        EncodingFormat.REL8: InstructionSpec(mnemonic='JSS', opcode=0x64, format=EncodingFormat.REL8),
     },
     'CALL': {
         EncodingFormat.IMM: InstructionSpec(mnemonic='CALL', opcode=0x09, format=EncodingFormat.IMM),
+        EncodingFormat.REL8: InstructionSpec(mnemonic='CALLS', opcode=0x65, format=EncodingFormat.REL8),
     },
     'RET': {
         EncodingFormat.NONE: InstructionSpec(mnemonic='RET', opcode=0x0A, format=EncodingFormat.NONE),
     },
+    'SYS': {
+        EncodingFormat.IMM: InstructionSpec(mnemonic='SYS', opcode=0x0B, format=EncodingFormat.IMM),
+    },
 
     # Memory
     'MOV': {
@@ -147,10 +211,18 @@ pattern_table = {
         EncodingFormat.REG_MEMIMM: InstructionSpec(mnemonic='STORDR', opcode=0x12, format=EncodingFormat.REG_MEMIMM),
         EncodingFormat.REG_IMM: InstructionSpec(mnemonic='STORMI', opcode=0x13, format=EncodingFormat.REG_IMM),
         EncodingFormat.REG_MEMREG: InstructionSpec(mnemonic='STORMR', opcode=0x14, format=EncodingFormat.REG_MEMREG),
+        EncodingFormat.REG_MEMBP: InstructionSpec(mnemonic='STORFR', opcode=0x4B, format=EncodingFormat.REG_MEMBP),
+        EncodingFormat.REG_MEMREGDISP: InstructionSpec(mnemonic='STORXR', opcode=0x51, format=EncodingFormat.REG_MEMREGDISP),
+        EncodingFormat.REG_MEMREGINC: InstructionSpec(mnemonic='STORPIR', opcode=0x55, format=EncodingFormat.REG_MEMREGINC),
+        EncodingFormat.REG_MEMREGDEC: InstructionSpec(mnemonic='STORPDR', opcode=0x59, format=EncodingFormat.REG_MEMREGDEC),
     },
     'LOAD': {
         EncodingFormat.REG_MEMIMM: InstructionSpec(mnemonic='LOADRD', opcode=0x15, format=EncodingFormat.REG_MEMIMM),
         EncodingFormat.REG_MEMREG: InstructionSpec(mnemonic='LOADRM', opcode=0x16, format=EncodingFormat.REG_MEMREG),
+        EncodingFormat.REG_MEMBP: InstructionSpec(mnemonic='LOADRF', opcode=0x4A, format=EncodingFormat.REG_MEMBP),
+        EncodingFormat.REG_MEMREGDISP: InstructionSpec(mnemonic='LOADRX', opcode=0x50, format=EncodingFormat.REG_MEMREGDISP),
+        EncodingFormat.REG_MEMREGINC: InstructionSpec(mnemonic='LOADRPI', opcode=0x54, format=EncodingFormat.REG_MEMREGINC),
+        EncodingFormat.REG_MEMREGDEC: InstructionSpec(mnemonic='LOADRPD', opcode=0x58, format=EncodingFormat.REG_MEMREGDEC),
     },
     'PUSH': {
         EncodingFormat.REG: InstructionSpec(mnemonic='PUSH', opcode=0x17, format=EncodingFormat.REG),
@@ -162,10 +234,18 @@ pattern_table = {
         EncodingFormat.REG_MEMIMM: InstructionSpec(mnemonic='STORBDR', opcode=0x19, format=EncodingFormat.REG_MEMIMM),
         EncodingFormat.REG_IMM: InstructionSpec(mnemonic='STORBMI', opcode=0x1A, format=EncodingFormat.REG_IMM),
         EncodingFormat.REG_MEMREG: InstructionSpec(mnemonic='STORBMR', opcode=0x1B, format=EncodingFormat.REG_MEMREG),
+        EncodingFormat.REG_MEMBP: InstructionSpec(mnemonic='STORBFR', opcode=0x4D, format=EncodingFormat.REG_MEMBP),
+        EncodingFormat.REG_MEMREGDISP: InstructionSpec(mnemonic='STORBXR', opcode=0x53, format=EncodingFormat.REG_MEMREGDISP),
+        EncodingFormat.REG_MEMREGINC: InstructionSpec(mnemonic='STORBPIR', opcode=0x57, format=EncodingFormat.REG_MEMREGINC),
+        EncodingFormat.REG_MEMREGDEC: InstructionSpec(mnemonic='STORBPDR', opcode=0x5B, format=EncodingFormat.REG_MEMREGDEC),
     },
     'LOADB': {
         EncodingFormat.REG_MEMIMM: InstructionSpec(mnemonic='LOADBRD', opcode=0x1C, format=EncodingFormat.REG_MEMIMM),
         EncodingFormat.REG_MEMREG: InstructionSpec(mnemonic='LOADBRM', opcode=0x1D, format=EncodingFormat.REG_MEMREG),
+        EncodingFormat.REG_MEMBP: InstructionSpec(mnemonic='LOADBRF', opcode=0x4C, format=EncodingFormat.REG_MEMBP),
+        EncodingFormat.REG_MEMREGDISP: InstructionSpec(mnemonic='LOADBRX', opcode=0x52, format=EncodingFormat.REG_MEMREGDISP),
+        EncodingFormat.REG_MEMREGINC: InstructionSpec(mnemonic='LOADBRPI', opcode=0x56, format=EncodingFormat.REG_MEMREGINC),
+        EncodingFormat.REG_MEMREGDEC: InstructionSpec(mnemonic='LOADBRPD', opcode=0x5A, format=EncodingFormat.REG_MEMREGDEC),
     },
 
     # Arithmetic
@@ -191,6 +271,20 @@ pattern_table = {
         EncodingFormat.REG_REG: InstructionSpec(mnemonic='DIVR', opcode=0x28, format=EncodingFormat.REG_REG),
         EncodingFormat.REG_IMM: InstructionSpec(mnemonic='DIVI', opcode=0x29, format=EncodingFormat.REG_IMM),
     },
+    'ADC': {
+        EncodingFormat.REG_REG: InstructionSpec(mnemonic='ADCR', opcode=0x2A, format=EncodingFormat.REG_REG),
+        EncodingFormat.REG_IMM: InstructionSpec(mnemonic='ADCI', opcode=0x2B, format=EncodingFormat.REG_IMM),
+    },
+    'SBC': {
+        EncodingFormat.REG_REG: InstructionSpec(mnemonic='SBCR', opcode=0x2C, format=EncodingFormat.REG_REG),
+        EncodingFormat.REG_IMM: InstructionSpec(mnemonic='SBCI', opcode=0x2D, format=EncodingFormat.REG_IMM),
+    },
+    'MULW': {
+        EncodingFormat.REG_REG: InstructionSpec(mnemonic='MULWR', opcode=0x2E, format=EncodingFormat.REG_REG),
+    },
+    'DIVMOD': {
+        EncodingFormat.REG_REG: InstructionSpec(mnemonic='DIVMODR', opcode=0x2F, format=EncodingFormat.REG_REG),
+    },
 
     # Bit ops
     'AND': {
@@ -240,6 +334,40 @@ pattern_table = {
     'SUBBP': {
         EncodingFormat.IMM: InstructionSpec(mnemonic='SUBBP', opcode=0x47, format=EncodingFormat.IMM),
     },
+    'ENTER': {
+        EncodingFormat.IMM: InstructionSpec(mnemonic='ENTER', opcode=0x48, format=EncodingFormat.IMM),
+    },
+    'LEAVE': {
+        EncodingFormat.NONE: InstructionSpec(mnemonic='LEAVE', opcode=0x49, format=EncodingFormat.NONE),
+    },
+
+    # Heap allocator
+    'ALLOC': {
+        EncodingFormat.REG_REG: InstructionSpec(mnemonic='ALLOCR', opcode=0x70, format=EncodingFormat.REG_REG),
+        EncodingFormat.REG_IMM: InstructionSpec(mnemonic='ALLOCI', opcode=0x71, format=EncodingFormat.REG_IMM),
+    },
+    'FREE': {
+        EncodingFormat.REG: InstructionSpec(mnemonic='FREE', opcode=0x72, format=EncodingFormat.REG),
+    },
+}
+
+# predefined constants for SYS service numbers
+SYS_SERVICES = {
+    'SYS_PUTS': '0',
+    'SYS_PUTU': '1',
+    'SYS_PUTI': '2',
+    'SYS_PUTX': '3',
+    'SYS_PARSEU': '4',
+    'SYS_PARSEI': '5',
+    'SYS_PARSEX': '6',
+    'SYS_GETS': '7',
+    'SYS_MEMSET': '8',
+}
+
+# short branch mnemonic -> long form spec, used by branch relaxation
+LONG_BRANCHES = {
+    specs[EncodingFormat.REL8].mnemonic: specs[EncodingFormat.IMM]
+    for specs in pattern_table.values() if EncodingFormat.REL8 in specs
 }
 
 class TokenTypes:
@@ -392,8 +520,22 @@ def parse_operand(string):
     # indirect handling
     if string.startswith('[') and string.endswith(']'):
         string = string[1:-1].strip()
+        # BP-relative: [BP], [BP+expr], [BP-expr]
+        if string == 'BP':
+            return OperandMemBP(tokenize_expr('+0'))
+        if string.startswith('BP') and string[2:].lstrip()[:1] in ('+', '-'):
+            return OperandMemBP(tokenize_expr(string[2:].strip()))
         if is_register(string):
             return OperandMemReg(parse_register(string))
+        # post-increment: [Rx+], pre-decrement: [-Rx]
+        if string.endswith('+') and is_register(string[:-1].strip()):
+            return OperandMemRegInc(parse_register(string[:-1].strip()))
+        if string.startswith('-') and is_register(string[1:].strip()):
+            return OperandMemRegDec(parse_register(string[1:].strip()))
+        # register + displacement: [Rx+expr], [Rx-expr]
+        sign = min((i for i in (string.find('+'), string.find('-')) if i > 0), default=-1)
+        if sign > 0 and is_register(string[:sign].strip()):
+            return OperandMemRegDisp(parse_register(string[:sign].strip()), tokenize_expr(string[sign:].strip()))
         else: 
             return OperandMemImm(tokenize_expr(string))
     # register handling
@@ -598,7 +740,7 @@ def encode_instruction(record, verbose=False):
             reg_byte = reg1 << 4
             record.encoded_bytes.append(reg_byte)
 
-        case EncodingFormat.REG_REG | EncodingFormat.REG_MEMREG:            
+        case EncodingFormat.REG_REG | EncodingFormat.REG_MEMREG | EncodingFormat.REG_MEMREGINC | EncodingFormat.REG_MEMREGDEC:
             reg1 = operands[0].reg
             reg2 = operands[1].reg
 
@@ -625,12 +767,56 @@ def encode_instruction(record, verbose=False):
                     record.encoded_bytes.append(higher)
                 case ExprTypes.EXTERN:
                     print(f"relocations in: {tokens}")
-                    record.relocations.append((tokens2[0][1], 0))
+                    record.relocations.append((tokens[0][1], 0))
                     record.encoded_bytes.append(0)
                     record.encoded_bytes.append(0)
                 case ExprTypes.EXTERN_CONST:
                     raise NotImplementedError("Offset not yet implemented.")
 
+        case EncodingFormat.REG_MEMBP:
+            reg1 = operands[0].reg
+            reg_byte = reg1 << 4
+            record.encoded_bytes.append(reg_byte)
+
+            tokens = operands[1].expr
+            if check_expr(tokens) != ExprTypes.LOCAL:
+                raise AssembleError("BP offset can't use external symbols.", record.line_num, record.line_content)
+            try:
+                value = recursive_eval(tokens)
+            except ValueError as e:
+                raise AssembleError(e, record.line_num, record.line_content)
+            if value < -128 or value > 127:
+                raise AssembleError("Invalid BP offset! Only -128..127 are allowed.", record.line_num, record.line_content)
+            record.encoded_bytes.append(value & LOWER_BYTE)
+
+        case EncodingFormat.REL8:
+            tokens = operands[0].expr
+            try:
+                value = recursive_eval(tokens) - (record.address + record.size)
+            except ValueError as e:
+                raise AssembleError(e, record.line_num, record.line_content)
+            if value < -128 or value > 127:
+                raise AssembleError("Short branch target out of range!", record.line_num, record.line_content)
+            record.encoded_bytes.append(value & LOWER_BYTE)
+
+        case EncodingFormat.REG_MEMREGDISP:
+            reg1 = operands[0].reg
+            reg2 = operands[1].reg
+            reg_byte = reg1 << 4 | reg2
+            record.encoded_bytes.append(reg_byte)
+
+            tokens = operands[1].expr
+            if check_expr(tokens) != ExprTypes.LOCAL:
+                raise AssembleError("Register displacement can't use external symbols.", record.line_num, record.line_content)
+            try:
+                value = recursive_eval(tokens)
+            except ValueError as e:
+                raise AssembleError(e, record.line_num, record.line_content)
+            if value < -32768 or value > 65535:
+                raise AssembleError("Invalid displacement! Only -32768..65535 are allowed.", record.line_num, record.line_content)
+            record.encoded_bytes.append(value & LOWER_BYTE)
+            record.encoded_bytes.append((value & HIGHER_BYTE) >> 8)
+
         case EncodingFormat.REG_IMM | EncodingFormat.REG_MEMIMM:            
             reg1 = operands[0].reg
             reg_byte = reg1 << 4
@@ -655,8 +841,8 @@ def encode_instruction(record, verbose=False):
                     record.encoded_bytes.append(lower)
                     record.encoded_bytes.append(higher)
                 case ExprTypes.EXTERN:
-                    print(f"relocations in: {tokens}")
-                    record.relocations.append((tokens[0][1], 0))
+                    print(f"relocations in: {tokens2}")
+                    record.relocations.append((tokens2[0][1], 0))
                     record.encoded_bytes.append(0)
                     record.encoded_bytes.append(0)
                 case ExprTypes.EXTERN_CONST:
@@ -771,6 +957,44 @@ def generate_object_listing(object):
     listing = '\n'.join(lines)
     return listing
 
+def generate_symbols(labels):
+    lines = []
+    for name, address in sorted(labels.items(), key=lambda item: item[1]):
+        lines.append(f"{address:04X} {name}")
+    return '\n'.join(lines) + '\n'
+
+# check if short branch reaches its target from current address
+def short_branch_fits(record):
+    tokens = record.payload.operands[0].expr
+    if check_expr(tokens) != ExprTypes.LOCAL:
+        return False
+    try:
+        target = recursive_eval(tokens)
+    except ValueError:
+        return False
+    return -128 <= target - (record.address + record.size) <= 127
+
+# Branch relaxation: branches start short, ones that don't reach are made long,
+# then addresses and labels are recomputed. Branches only grow, so it converges.
+def relax_branches(records, label_records):
+    changed = True
+    while changed:
+        changed = False
+        for record in records:
+            if record.type != RecordTypes.INSTRUCTION or record.payload.spec.format != EncodingFormat.REL8:
+                continue
+            if not short_branch_fits(record):
+                record.payload.spec = LONG_BRANCHES[record.payload.spec.mnemonic]
+                record.size = FORMAT_SPECS[EncodingFormat.IMM].length
+                changed = True
+        if changed:
+            address = 0
+            for record in records:
+                record.address = address
+                address += record.size
+            for label, index in label_records.items():
+                labels[label] = records[index].address if index < len(records) else address
+
 def match_format(formats, operands):
     for fmt in formats.items():
         # print(fmt[1].operand_types)
@@ -780,7 +1004,8 @@ def match_format(formats, operands):
     raise ValueError("No matching format!")
 
 labels = {}
-macros = {}
+label_records = {} # label -> index of record it points to
+macros = dict(SYS_SERVICES)
 externs = []
 exports = []
 
@@ -793,6 +1018,7 @@ def main():
     parser.add_argument("input_file", help="path to input source file")
     parser.add_argument("-o", "--output", help="path to assembled output file")
     parser.add_argument("-v", "--verbose", action="store_true", help="enable verbose output")
+    parser.add_argument("-s", "--symbols", help="path to symbol table output file (for VM debugger)")
     parser.add_argument(
         "-f", "--format", 
         choices=["bin", "obj"],
@@ -831,6 +1057,7 @@ def main():
                     if label in labels:
                         raise AssembleError(f"Duplicate label: {label}", i, raw)
                     labels[label] = cur_address
+                    label_records[label] = len(records)
 
                     rest = potential_rest
             
@@ -894,6 +1121,10 @@ def main():
                             except ValueError as e:
                                 raise AssembleError(e, i, raw)
 
+                            # branches start short, relaxed after first pass
+                            if fmt[0] == EncodingFormat.IMM and EncodingFormat.REL8 in pattern_table[instruction]:
+                                fmt = (EncodingFormat.REL8, FORMAT_SPECS[EncodingFormat.REL8])
+
                             if fmt[0] in pattern_table[instruction]:
                                 instr_spec = pattern_table[instruction][fmt[0]]
                             else:
@@ -918,6 +1149,10 @@ def main():
         for error in errors:
             print(error.report(), file=sys.stderr)
         sys.exit(1)
+
+    # Pick short branches where target is in range, updates addresses and labels
+    relax_branches(records, label_records)
+
     # Verbose outout
     if args.verbose:
         print("Labels: ", labels)
@@ -970,6 +1205,11 @@ def main():
         print("\nListing:")   
         print(generate_listing(records))
 
+    # Symbol table
+    if args.symbols:
+        with open(args.symbols, 'w') as file:
+            file.write(generate_symbols(labels))
+
     match args.format:
         case "bin":
             # Encode binary
@@ -6,18 +6,10 @@
 JMP start
 
 _sub: 
-; prologue
-GETBP R15
-PUSH R15 ; = PUSH BP
-
-GETSP R15
-SETBP R15 ; = MOV BP, SP
-; now R15 = BP
+ENTER 0 ; = PUSH BP, MOV BP, SP
 
 ; arg1
-MOV R14, R15
-ADD R14, 6
-LOAD R14, [R14]; = LOAD BP + 6
+LOAD R14, [BP+6]
 
 ; actual function
 MOV R13, R14
@@ -33,12 +25,7 @@ CALL _sub
 ADDSP 2 ; fix stack
 
 epilogue: 
-; epilogue
-GETBP R15
-SETSP R15 ; = MOV SP, BP 
-
-POP R15
-SETBP R15 ; = POP BP
+LEAVE ; = MOV SP, BP, POP BP
 RET
 
 start:
@@ -50,4 +37,4 @@ PUSH R0
 CALL _sub
 ADDSP 2 ; fix stack 
 
-HLT
\ No newline at end of file
+HLT
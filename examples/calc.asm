@@ -15,30 +15,18 @@ msg_error_2:   .STR "Empty number"
 msg_error_3:   .STR "Invalid operation"
 msg_error_4:   .STR "Integer underflow"
 msg_error_5:   .STR "Integer overflow"
+msg_error_6:   .STR "Division by zero"
 
 ; ============================================================================================
 ; READ_STRING
 ; Arguments: R0 - write address
-; Uses: R0-R2
-; Operation: writes string to memory, R1 - string length, R0 - final address
+; Uses: R0-R1
+; Operation: reads line to memory (up to 63 chars), R1 - string length
 ; ============================================================================================
 readStr: 
-    MOV R1, 0               ; string length
-    input_loop:
-    LOADB R2, [RX_ADDR]     ; read char
-
-    CMP R2, 10              ; check for EoL
-    JZ _input_str_epilogue
-
-    STORB R2, [R0]          ; store char to memory
-    INC R0
-    INC R1
-    JMP input_loop
-
-    _input_str_epilogue:
-        MOV R2, 0
-        STORB R2, [R0]          ; add zero-termination
-        RET
+    MOV R1, 64              ; buffer size
+    SYS SYS_GETS
+    RET
 
 ; ============================================================================================
 ; ERROR_HANDLER
@@ -51,21 +39,11 @@ errorHandler:
 ; ============================================================================================
 ; PRINT_STRING
 ; Arguments: R0 - string address
-; Uses: R0-R1
 ; Operation: prints string to console, zero-terminated
 ; ============================================================================================
 printStr: 
-    LOADB R1, [R0]
-
-    CMP R1, 0               ; check for EoS (zero-termination)
-    JZ _print_str_epilogue
-
-    STORB R1, [TX_ADDR]     ; print char
-    INC R0
-    JMP printStr
-
-    _print_str_epilogue:
-        RET
+    SYS SYS_PUTS
+    RET
 
 ; ============================================================================================
 ; NEW_LINE
@@ -80,8 +58,8 @@ newLine:
 ; ============================================================================================
 ; PARSE_NUMBER
 ; Arguments: R0 - string address, R1 - string length
-; Uses: R0-R4
-; Operation: R2 - number, using backwards scan
+; Uses: R0-R3
+; Operation: R2 - number
 ; ============================================================================================
 parseNumber: 
     MOV R2, 0 ; clear output register
@@ -94,80 +72,30 @@ parseNumber:
         HLT
     len_nz:
 
-    ADD R1, R0                  ; now R1 contains address of string end
-    DEC R1                      
-    MOV R3, 1                   ; digit multiplier
-
-    parse_loop:
-        LOADB R4, [R1]              ; load digit char
-
-        CMP R4, 48
-        JS digit_invalid            ; below '0'
-
-        CMP R4, 58
-        JS digit_ok                 ; below or '9'
-        JMP digit_invalid           ; invalid char (not a digit)
-
-        digit_invalid:
-            MOV R0, msg_error
-            CALL printStr
-            MOV R0, msg_error_1
-            CALL printStr
-            HLT
+    MOV R3, R1                  ; whole string must be parsed
+    SYS SYS_PARSEU              ; R0 - number, R1 - chars parsed, C - error
+    JC digit_invalid
+    CMP R1, R3
+    JNZ digit_invalid           ; invalid char (not a digit)
 
-        digit_ok:
-            SUB R4, 48                  ; convert char to number
-            MUL R4, R3                  ; now R4 contains current digit (a * n^10)
-            MUL R3, 10
-
-            ADD R2, R4                  ; add current digit to final number
-
-            CMP R1, R0                  ; check remaining digits
-            JZ _parse_number_epilogue
-
-            DEC R1
-            JMP parse_loop
+    MOV R2, R0
+    RET
 
-    _parse_number_epilogue:
-        RET
+    digit_invalid:
+        MOV R0, msg_error
+        CALL printStr
+        MOV R0, msg_error_1
+        CALL printStr
+        HLT
 
 ; ============================================================================================
 ; PRINT_NUMBER
 ; Arguments: R0 - number
-; Uses: R0-R3
 ; Operation: prints number to console 
 ; ============================================================================================
 printNumber: 
-    MOV R3, 0                   ; digits
-
-    print_number_loop:
-        MOV R1, R0
-        MOV R2, R0
-
-        DIV R1, 10
-        MUL R1, 10
-        SUB R2, R1                  ; now R2 contains a % 10
-
-        ADD R2, 48                  ; convert to char
-        PUSH R2                     ; push chars to stack
-        INC R3
-
-        DIV R0, 10                  ; reduce number by 1 digit
-
-        CMP R0, 0                   ; while number > 0
-        JNZ print_number_loop
-
-        print_digits_loop:
-            CMP R3, 0
-            JZ _print_number_epilogue
-
-            POP R2                      ; pop from stack to print in reverse order
-            STORB R2, [TX_ADDR]
-            DEC R3
-            JMP print_digits_loop
-
-        _print_number_epilogue:
-            RET
+    SYS SYS_PUTU
+    RET
 
 ; ============================================================================================
 start:
@@ -239,6 +167,8 @@ start:
 
     _div:
         ; calculate div
+        CMP R2, 0
+        JZ _div_by_zero
         DIV R5, R2 
         JMP _output
     
@@ -267,4 +197,12 @@ _int_overflow:
     CALL printStr
     MOV R0, msg_error_5
     CALL printStr
-    HLT
\ No newline at end of file
+    HLT
+
+_div_by_zero:
+    ; Division by zero
+    MOV R0, msg_error
+    CALL printStr
+    MOV R0, msg_error_6
+    CALL printStr
+    HLT
@@ -0,0 +1,71 @@
+; This program tests register addressing modes:
+; [Rx+disp], [Rx-disp], post-increment [Rx+] and pre-decrement [-Rx].
+
+.DEF OUT_ADDRESS 0xF801
+.DEF BUFFER 0x4000
+
+JMP start
+
+msg: .STR "abc"
+table: .DB 0x31, 0x00, 0x32, 0x00, 0x33, 0x00
+
+start:
+    ; copy string to buffer with post-increment, including terminator
+    MOV R0, msg
+    MOV R1, BUFFER
+copy:
+    LOADB R2, [R0+]
+    STORB R2, [R1+]
+    CMP R2, 0
+    JNZ copy
+
+    ; print it back
+    MOV R0, BUFFER
+print:
+    LOADB R2, [R0+]
+    CMP R2, 0
+    JZ print_done
+    STORB R2, [OUT_ADDRESS]
+    JMP print
+print_done:
+
+    ; print it reversed with pre-decrement, R0 points past terminator
+    DEC R0
+reverse:
+    LOADB R2, [-R0]
+    STORB R2, [OUT_ADDRESS]
+    CMP R0, BUFFER
+    JNZ reverse
+
+    ; word table indexed with displacement
+    MOV R3, 4
+table_loop:
+    LOAD R2, [R3+table]
+    STORB R2, [OUT_ADDRESS]
+    CMP R3, 0
+    JZ table_done
+    SUB R3, 2
+    JMP table_loop
+table_done:
+
+    ; word stack growing down with pre-decrement, popped with post-increment
+    MOV R5, BUFFER + 0x10
+    MOV R2, 0x78        ; 'x'
+    STOR R2, [-R5]
+    MOV R2, 0x79        ; 'y'
+    STOR R2, [-R5]
+    LOAD R2, [R5+]
+    STORB R2, [OUT_ADDRESS]
+    LOAD R2, [R5+]
+    STORB R2, [OUT_ADDRESS]
+
+    ; negative displacement and byte store with displacement
+    MOV R4, BUFFER + 2
+    MOV R2, 0x7A        ; 'z'
+    STORB R2, [R4+1]
+    LOADB R2, [R4 - 2]
+    STORB R2, [OUT_ADDRESS]
+    LOADB R2, [R4+1]
+    STORB R2, [OUT_ADDRESS]
+
+    HLT
@@ -0,0 +1,69 @@
+; This program tests heap allocator: size classes, reuse of freed blocks,
+; large blocks, allocation failure and fault on double free.
+
+.DEF OUT_ADDRESS 0xF801
+
+JMP start
+
+; ============================================================================================
+; PRINT_HEX
+; Arguments: R0 - number
+; Operation: prints number in hex and space
+; ============================================================================================
+printHex:
+    SYS SYS_PUTX
+    MOV R15, 32
+    STORB R15, [OUT_ADDRESS]
+    RET
+
+start:
+    ; small blocks are rounded to size classes
+    ALLOC R0, 5                 ; 8-byte class, new page
+    MOV R4, R0
+    CALL printHex
+    ALLOC R0, 8                 ; same page, next slot
+    MOV R5, R0
+    CALL printHex
+    MOV R1, 100
+    ALLOC R0, R1                ; 128-byte class, new page
+    MOV R6, R0
+    CALL printHex
+
+    ; blocks are usable memory
+    MOV R1, 0x1234
+    STOR R1, [R5]
+    LOAD R0, [R5]
+    CALL printHex
+
+    ; freed slot is reused
+    FREE R4
+    ALLOC R0, 1
+    CALL printHex
+
+    ; large block takes whole pages, freed pages are reused
+    ALLOC R0, 600               ; 3 pages
+    MOV R7, R0
+    CALL printHex
+    FREE R6                     ; 128-byte page becomes free
+    ALLOC R0, 256
+    CALL printHex
+    FREE R7
+    ALLOC R0, 512
+    CALL printHex
+
+    ; request larger than arena fails
+    ALLOC R0, 0xF000
+    JC alloc_failed
+    JMP alloc_done
+alloc_failed:
+    MOV R0, 70                  ; 'F'
+    STORB R0, [OUT_ADDRESS]
+alloc_done:
+
+    ; freeing 0 does nothing, freeing twice is a fault
+    MOV R0, 0
+    FREE R0
+    FREE R5
+    FREE R5
+
+    HLT
@@ -0,0 +1,97 @@
+; This program tests multi-precision arithmetic: ADC/SBC, MULW, DIVMOD
+; and division by zero fault.
+
+.DEF OUT_ADDRESS 0xF801
+.DEF ASCII_0 48
+
+JMP start
+
+start:
+    ; 32-bit add: 0x0001FFFF + 1 = 0x00020000 (R1:R0 + R3:R2)
+    MOV R0, 0xFFFF
+    MOV R1, 1
+    MOV R2, 1
+    MOV R3, 0
+    ADD R0, R2
+    ADC R1, R3
+    ADD R1, ASCII_0
+    STORB R1, [OUT_ADDRESS]     ; '2'
+    ADD R0, ASCII_0
+    STORB R0, [OUT_ADDRESS]     ; '0'
+
+    ; 32-bit sub: 0x00020000 - 1 = 0x0001FFFF
+    MOV R0, 0
+    MOV R1, 2
+    SUB R0, 1
+    SBC R1, 0
+    ADD R1, ASCII_0
+    STORB R1, [OUT_ADDRESS]     ; '1'
+    ADD R0, 1
+    JNZ sub_bad
+    MOV R0, 70                  ; 'F'
+    STORB R0, [OUT_ADDRESS]
+sub_bad:
+
+    ; ADC adds carry flag, carry is cleared when there is no overflow
+    MOV R0, 0
+    CMP R0, 1                   ; sets C
+    MOV R0, 5
+    ADC R0, ASCII_0
+    STORB R0, [OUT_ADDRESS]     ; '6'
+    ADC R0, 0
+    STORB R0, [OUT_ADDRESS]     ; '6'
+
+    ; widening multiply: 300 * 300 = 90000 = 0x00015F90
+    MOV R0, 300
+    MOV R1, 300
+    MULW R0, R1
+    JC mulw_c
+    JMP mulw_nc
+mulw_c:
+    MOV R2, 67                  ; 'C'
+    STORB R2, [OUT_ADDRESS]
+mulw_nc:
+    ADD R1, ASCII_0
+    STORB R1, [OUT_ADDRESS]     ; '1'
+    CMP R0, 0x5F90
+    JNZ mulw_bad
+    MOV R2, 76                  ; 'L'
+    STORB R2, [OUT_ADDRESS]
+mulw_bad:
+
+    ; MUL sets carry only on overflow
+    MOV R0, 2
+    MUL R0, 3
+    JC mul_c
+    ADD R0, ASCII_0
+    STORB R0, [OUT_ADDRESS]     ; '6'
+mul_c:
+
+    ; quotient and remainder
+    MOV R0, 47
+    MOV R1, 10
+    DIVMOD R0, R1
+    ADD R0, ASCII_0
+    STORB R0, [OUT_ADDRESS]     ; '4'
+    ADD R1, ASCII_0
+    STORB R1, [OUT_ADDRESS]     ; '7'
+
+    ; same register for both results: low word and quotient win
+    MOV R0, 300
+    MULW R0, R0                 ; 90000 = 0x00015F90
+    CMP R0, 0x5F90
+    JNZ mulw_same_bad
+    MOV R2, 83                  ; 'S'
+    STORB R2, [OUT_ADDRESS]
+mulw_same_bad:
+    MOV R0, 7
+    DIVMOD R0, R0
+    ADD R0, ASCII_0
+    STORB R0, [OUT_ADDRESS]     ; '1'
+
+    ; division by zero faults
+    MOV R0, 1
+    MOV R1, 0
+    DIV R0, R1
+
+    HLT
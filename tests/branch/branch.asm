@@ -0,0 +1,58 @@
+; This program tests branch relaxation: short branches where target is in range
+; of signed 8-bit displacement, long ones otherwise, in both directions.
+
+.DEF OUT_ADDRESS 0xF801
+.DEF ASCII_0 48
+
+JMP start                   ; long, skips over padding
+
+pad_far: .STR "cccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccc"
+
+; ============================================================================================
+; PRINT_CHAR
+; Arguments: R1 - char
+; ============================================================================================
+printChar:
+    STORB R1, [OUT_ADDRESS]
+    RET
+
+start:
+    ; short backward loop
+    MOV R0, 3
+loop:
+    MOV R1, R0
+    ADD R1, ASCII_0
+    CALL printChar          ; short, backward
+    DEC R0
+    JNZ loop                ; short, backward
+
+    ; forward branches over exactly 127 and 128 bytes
+    JMP skip_127            ; short, displacement 127
+pad_127: .STR "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+skip_127:
+    MOV R1, 83              ; 'S'
+    CALL printChar
+    JMP skip_128            ; long, displacement 128
+pad_128: .STR "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb"
+skip_128:
+    MOV R1, 76              ; 'L'
+    CALL printChar
+
+    ; far calls and jumps forward and back
+    CALL far                ; long, forward
+    JMP finish              ; long, forward
+
+back:
+    MOV R1, 98              ; 'b'
+    CALL printChar
+    HLT
+
+far:
+    MOV R1, 102             ; 'f'
+    CALL printChar
+    RET
+
+pad_end: .STR "cccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccc"
+
+finish:
+    JMP back                ; long, backward
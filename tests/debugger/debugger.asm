@@ -0,0 +1,22 @@
+; This program tests the debugger console: breakpoints on labels,
+; watchpoints on heap, stepping, registers and memory dump.
+; Console script is in debugger.cmd, symbols are generated by the runner.
+
+.DEF OUT_ADDRESS 0xF801
+.DEF COUNTER 0x4000
+
+JMP start
+
+msg: .DB 0x68, 0x69, 0x00
+
+start:
+    MOV R0, 3
+    MOV R1, 0
+loop:
+    ADD R1, 1
+    STOR R1, [COUNTER]
+    SUB R0, 1
+    JNZ loop
+    MOV R2, 79                  ; 'O'
+    STORB R2, [OUT_ADDRESS]
+    HLT
@@ -0,0 +1,14 @@
+break loop
+watch 0x4000
+info
+continue
+regs
+step
+step
+continue
+delete loop
+continue
+mem 0x4000 4
+mem msg 3
+unwatch 0x4000
+continue
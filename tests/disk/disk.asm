@@ -0,0 +1,109 @@
+; This program tests block storage device: sector reads and writes
+; into heap buffers and error status on invalid transfers.
+; Disk image has 2 sectors, "zero" and "one". Runner attaches a scratch
+; copy of disk.img, so a failed run leaves the fixture unchanged.
+
+.DEF OUT_ADDRESS 0xF801
+.DEF DISK_SECTOR 0xF830
+.DEF DISK_BUFFER 0xF832
+.DEF DISK_COUNT 0xF834
+.DEF DISK_COMMAND 0xF836
+.DEF DISK_STATUS 0xF838
+.DEF DISK_SIZE 0xF83A
+.DEF DISK_READ 1
+.DEF DISK_WRITE 2
+.DEF ASCII_0 48
+
+JMP start
+
+; ============================================================================================
+; DISK_TRANSFER
+; Arguments: R0 - sector, R1 - buffer, R2 - count, R3 - command
+; Operation: runs disk command, prints status digit
+; ============================================================================================
+diskTransfer:
+    STOR R0, [DISK_SECTOR]
+    STOR R1, [DISK_BUFFER]
+    STOR R2, [DISK_COUNT]
+    STOR R3, [DISK_COMMAND]
+    LOAD R0, [DISK_STATUS]
+    ADD R0, ASCII_0
+    STORB R0, [OUT_ADDRESS]
+    RET
+
+; ============================================================================================
+; PRINT_STRING
+; Arguments: R0 - string address
+; Operation: prints zero-terminated string
+; ============================================================================================
+printStr:
+    LOADB R1, [R0+]
+    CMP R1, 0
+    JZ _print_str_done
+    STORB R1, [OUT_ADDRESS]
+    JMP printStr
+_print_str_done:
+    RET
+
+start:
+    LOAD R0, [DISK_SIZE]
+    ADD R0, ASCII_0
+    STORB R0, [OUT_ADDRESS]     ; '2'
+
+    ; read whole disk
+    MOV R0, 0
+    MOV R1, 0x4000
+    MOV R2, 2
+    MOV R3, DISK_READ
+    CALL diskTransfer           ; '1'
+    MOV R0, 0x4000
+    CALL printStr               ; "zero"
+    MOV R0, 0x4200
+    CALL printStr               ; "one"
+
+    ; overwrite sector 1 with modified sector 0 and read it back
+    MOV R0, 88                  ; 'X'
+    STORB R0, [0x4000]
+    MOV R0, 1
+    MOV R1, 0x4000
+    MOV R2, 1
+    MOV R3, DISK_WRITE
+    CALL diskTransfer           ; '1'
+    MOV R0, 1
+    MOV R1, 0x4400
+    MOV R2, 1
+    MOV R3, DISK_READ
+    CALL diskTransfer           ; '1'
+    MOV R0, 0x4400
+    CALL printStr               ; "Xero"
+
+    ; restore sector 1
+    MOV R0, 1
+    MOV R1, 0x4200
+    MOV R2, 1
+    MOV R3, DISK_WRITE
+    CALL diskTransfer           ; '1'
+
+    ; errors: past end of disk, buffer in program space, buffer overlapping I/O, bad command
+    MOV R0, 1
+    MOV R1, 0x4000
+    MOV R2, 2
+    MOV R3, DISK_READ
+    CALL diskTransfer           ; '2'
+    MOV R0, 0
+    MOV R1, 0x0000
+    MOV R2, 1
+    MOV R3, DISK_READ
+    CALL diskTransfer           ; '2'
+    MOV R0, 0
+    MOV R1, 0xF700
+    MOV R2, 1
+    MOV R3, DISK_READ
+    CALL diskTransfer           ; '2'
+    MOV R0, 0
+    MOV R1, 0x4000
+    MOV R2, 1
+    MOV R3, 7
+    CALL diskTransfer           ; '2'
+
+    HLT
@@ -0,0 +1,50 @@
+; This program tests stack frames: ENTER/LEAVE and BP-relative addressing.
+; Arguments are referenced as [BP+6], [BP+8], locals as [BP], [BP-2].
+
+.DEF OUT_ADDRESS 0xF801
+.DEF ASCII_0 48
+
+JMP start
+
+; ============================================================================================
+; COUNTDOWN
+; Arguments: [BP+6] - n, [BP+8] - character offset
+; Operation: prints n..1 as digits shifted by offset, recursively
+; ============================================================================================
+_countdown:
+    ENTER 4                 ; 2 locals
+    LOAD R0, [BP+6]         ; n
+    LOAD R1, [BP + 8]       ; offset
+    STOR R0, [BP]           ; local n
+    ADD R1, ASCII_0
+    STOR R1, [BP-2]         ; local base char
+
+    ADD R0, R1
+    STORB R0, [OUT_ADDRESS]
+
+    LOAD R0, [BP]
+    DEC R0
+    JZ _countdown_done
+
+    LOAD R1, [BP+8]
+    PUSH R1                 ; arg2
+    PUSH R0                 ; arg1
+    CALL _countdown
+    ADDSP 4
+
+    LOADB R0, [BP-2]        ; local survives the call
+    STORB R0, [OUT_ADDRESS]
+
+_countdown_done:
+    LEAVE
+    RET
+
+start:
+    MOV R0, 0
+    PUSH R0                 ; arg2
+    MOV R0, 5
+    PUSH R0                 ; arg1
+    CALL _countdown
+    ADDSP 4
+
+    HLT
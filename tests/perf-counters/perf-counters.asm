@@ -0,0 +1,23 @@
+; This program tests performance counters.
+; It measures instructions executed by a loop and prints count + 40 as a char.
+.DEF INSTRUCTIONS_LO 0xF810
+.DEF INSTRUCTIONS_HI 0xF812
+.DEF BRANCHES_LO 0xF81C
+.DEF BRANCHES_HI 0xF81E
+.DEF TX_ADDR 0xF801
+
+    LOAD R0, [INSTRUCTIONS_LO]
+    LOAD R5, [INSTRUCTIONS_HI]
+    MOV R2, 10
+loop:
+    DEC R2
+    JNZ loop
+    LOAD R1, [INSTRUCTIONS_LO]
+    SUB R1, R0
+    ADD R1, 40              ; 23 instructions -> '?'
+    STORB R1, [TX_ADDR]
+
+    LOAD R1, [BRANCHES_LO]  ; 9 taken branches -> 'B'
+    ADD R1, 57
+    STORB R1, [TX_ADDR]
+    HLT
@@ -0,0 +1,30 @@
+; This program tests reverse execution in debugger console: more
+; checkpoints than the ring holds, replay of serial input and output,
+; and stepping back from a fault. Console script is in reverse.cmd.
+
+.DEF OUT_ADDRESS 0xF801
+.DEF COUNTER 0x4000
+.DEF BUFFER 0x4010
+
+JMP start
+
+start:
+    ; 100 iterations, 4 instructions each: over 64 checkpoints with -k 4
+    MOV R0, 100
+    MOV R1, 0
+loop:
+    ADD R1, 1
+    STOR R1, [COUNTER]
+    SUB R0, 1
+    JNZ loop
+done:
+    MOV R0, BUFFER
+    MOV R1, 16
+    SYS SYS_GETS
+    MOV R0, BUFFER
+    SYS SYS_PUTS
+    LOADB R2, [0xF800]          ; next line, one char
+    STORB R2, [OUT_ADDRESS]
+    MOV R3, 0
+    DIV R2, R3                  ; division by zero faults
+    HLT
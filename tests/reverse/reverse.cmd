@@ -0,0 +1,17 @@
+break done
+continue
+rs 200
+regs
+mem 0x4000 2
+continue
+delete done
+continue
+regs
+rs 8
+mem 0x4010 4
+regs
+continue
+regs
+mem 0x4010 4
+rs 1000
+regs
@@ -8,16 +8,26 @@ FAIL=0
 for t in "$TEST_DIR"/*/ ; do
     name=$(basename "$t")
     echo "Test: $name"
-    # Assemble
-    $ASM "$t/$name.asm" -o "$t/$name.bin" -f bin || { echo "  ASSEMBLY FAIL"; FAIL=$((FAIL+1)); continue; }
+    # Assemble, symbol table is for debugger tests
+    $ASM "$t/$name.asm" -o "$t/$name.bin" -f bin -s "$t/$name.sym" || { echo "  ASSEMBLY FAIL"; FAIL=$((FAIL+1)); continue; }
+    # Extra VM arguments, paths relative to tests directory
+    ARGS=""
+    if [ -f "$t/args.txt" ]; then
+        ARGS=$(cat "$t/args.txt")
+    fi
+    # Disk image fixture, test writes go to a scratch copy
+    if [ -f "$t/$name.img" ]; then
+        cp "$t/$name.img" "$t/scratch.img"
+    fi
     # Run VM, capture output
     if [ -f "$t/input.txt" ]; then
-        "$VM" "$t/$name.bin" -t < "$t/input.txt" > "$t/output.actual" 2>&1
+        "$VM" "$t/$name.bin" -t $ARGS < "$t/input.txt" > "$t/output.actual" 2>&1
     else
-        "$VM" "$t/$name.bin" -t > "$t/output.actual" 2>&1
+        "$VM" "$t/$name.bin" -t $ARGS > "$t/output.actual" 2>&1
     fi
     # Remove binary 
-    rm "$t/$name.bin"
+    rm "$t/$name.bin" "$t/$name.sym"
+    rm -f "$t/scratch.img"
     # Compare
     if diff -u "$t/output.expected" "$t/output.actual" > "$t/diff.txt"; then
         echo "  PASS"
@@ -0,0 +1,111 @@
+; This program tests SYS host calls: printing and parsing numbers,
+; strings, line input, memory fill and fault on buffer outside heap.
+
+.DEF OUT_ADDRESS 0xF801
+.DEF BUFFER 0x4000
+
+JMP start
+
+msg: .STR "sys"
+big: .STR "70000"
+mixed: .STR "12ab"
+
+; ============================================================================================
+; NEW_LINE
+; Uses: R15
+; ============================================================================================
+newLine:
+    MOV R15, 10
+    STORB R15, [OUT_ADDRESS]
+    RET
+
+start:
+    MOV R0, msg
+    SYS SYS_PUTS
+    CALL newLine
+
+    ; number printing
+    MOV R0, 65535
+    SYS SYS_PUTU
+    CALL newLine
+    SYS SYS_PUTI                ; -1
+    CALL newLine
+    MOV R0, 0xBEEF
+    SYS SYS_PUTX
+    CALL newLine
+
+    ; read line and print it with its length
+    MOV R0, BUFFER
+    MOV R1, 32
+    SYS SYS_GETS
+    SYS SYS_PUTS
+    MOV R0, R1
+    SYS SYS_PUTU
+    CALL newLine
+
+    ; signed decimal
+    MOV R0, BUFFER
+    MOV R1, 32
+    SYS SYS_GETS
+    SYS SYS_PARSEI
+    SYS SYS_PUTI                ; -123
+    MOV R0, R1
+    SYS SYS_PUTU                ; 4 chars
+    CALL newLine
+
+    ; hex
+    MOV R0, BUFFER
+    MOV R1, 32
+    SYS SYS_GETS
+    SYS SYS_PARSEX
+    SYS SYS_PUTU                ; 32767
+    CALL newLine
+
+    ; out of range sets carry
+    MOV R0, big
+    SYS SYS_PARSEU
+    JC parse_error
+    JMP parse_ok
+parse_error:
+    MOV R15, 67                 ; 'C'
+    STORB R15, [OUT_ADDRESS]
+parse_ok:
+    ; parsing stops at first non-digit
+    MOV R0, mixed
+    SYS SYS_PARSEU
+    SYS SYS_PUTU                ; 12
+    MOV R0, R1
+    SYS SYS_PUTU                ; 2 chars
+    CALL newLine
+
+    ; line longer than buffer is split
+    MOV R0, BUFFER
+    MOV R1, 4
+    SYS SYS_GETS
+    SYS SYS_PUTS                ; abc
+    MOV R0, BUFFER
+    MOV R1, 32
+    SYS SYS_GETS
+    SYS SYS_PUTS                ; defghijk
+    CALL newLine
+
+    ; memory fill
+    MOV R0, BUFFER
+    MOV R1, 122                 ; 'z'
+    MOV R2, 3
+    SYS SYS_MEMSET
+    MOV R1, 0
+    MOV R2, 1
+    ADD R0, 3
+    SYS SYS_MEMSET
+    MOV R0, BUFFER
+    SYS SYS_PUTS                ; zzz
+    CALL newLine
+
+    ; buffer in program space faults
+    MOV R0, 0
+    MOV R1, 0
+    MOV R2, 1
+    SYS SYS_MEMSET
+
+    HLT
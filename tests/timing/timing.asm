@@ -0,0 +1,33 @@
+; This program tests timing model: opcode latencies from --latency file,
+; branch penalty for jumps, calls and returns, and cache hits and misses
+; in a small direct-mapped cache (--cache 4,1,16).
+
+.DEF OUT_ADDRESS 0xF801
+.DEF A 0x4000
+.DEF B 0x4040                   ; same set as A
+
+JMP start
+
+; ============================================================================================
+; TOUCH - loads A and B, they evict each other
+; Uses: R15
+; ============================================================================================
+touch:
+    LOAD R15, [A]
+    LOAD R15, [B]
+    RET
+
+start:
+    MOV R0, 3
+loop:
+    CALL touch
+    LOAD R1, [A+2]              ; same line as A: miss after B evicted it
+    LOAD R1, [A+4]              ; hit
+    SUB R0, 1
+    JNZ loop
+
+    MOV R2, 6
+    MUL R2, 7
+    ADD R2, 6                   ; 48 = '0'
+    STORB R2, [OUT_ADDRESS]
+    HLT